@@ -23,7 +23,7 @@
 # qt               5.4.1
 # libkeyfinder     2.2.1
 #  \-> fftw        3.3.4
-# libav            0.7.7
+# libav            10.7
 # taglib           1.10
 
 QT += \
@@ -64,6 +64,7 @@ QMAKE_CXXFLAGS += -D__STDC_CONSTANT_MACROS # for libav
 unix|macx {
   LIBS += -L/usr/local/lib
   LIBS += -lkeyfinder
+  LIBS += -lfftw3
   LIBS += -lavcodec
   LIBS += -lavformat
   LIBS += -lavutil
@@ -87,6 +88,7 @@ win32 {
   DEPENDPATH += C:/mingw32/local/bin
   LIBS += -LC:/mingw32/local/bin
   LIBS += -lkeyfinder0
+  LIBS += -lfftw3-3
   LIBS += -lavcodec
   LIBS += -lavformat
   LIBS += -lavutil
@@ -0,0 +1,63 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#include "analysiscontext.h"
+
+QThreadStorage<AnalysisContext*> AnalysisContext::contexts;
+
+AnalysisContext::AnalysisContext() : workspace(new KeyFinder::Workspace()) { }
+
+AnalysisContext::~AnalysisContext() {
+  delete workspace;
+}
+
+AnalysisContext* AnalysisContext::forCurrentThread() {
+  if (!contexts.hasLocalData()) {
+    contexts.setLocalData(new AnalysisContext());
+  }
+  return contexts.localData();
+}
+
+void AnalysisContext::reset() {
+  // the adapters are detached so the old workspace doesn't delete them, and
+  // the rest of it (buffers, filter history, chromagram) goes with it
+  KeyFinder::FftAdapter* fft = workspace->getFftAdapter();
+  KeyFinder::InverseFftAdapter* ifft = workspace->getIFftAdapter();
+  workspace->setFftAdapter(NULL);
+  workspace->setIFftAdapter(NULL);
+  delete workspace;
+  workspace = new KeyFinder::Workspace();
+  workspace->setFftAdapter(fft);
+  workspace->setIFftAdapter(ifft);
+}
+
+KeyFinder::KeyFinder& AnalysisContext::getKeyFinder() {
+  return keyFinder;
+}
+
+KeyFinder::Workspace& AnalysisContext::getWorkspace() {
+  return *workspace;
+}
+
+KeyFinder::AudioData& AnalysisContext::getDecodeBuffer() {
+  return decodeBuffer;
+}
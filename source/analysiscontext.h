@@ -0,0 +1,57 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#ifndef ANALYSISCONTEXT_H
+#define ANALYSISCONTEXT_H
+
+#include <QThreadStorage>
+
+#include "keyfinder/keyfinder.h"
+#include "keyfinder/audiodata.h"
+
+/*
+
+Everything a worker thread needs to analyse a file, kept for the life of the
+thread rather than rebuilt per file. The KeyFinder keeps its filter and
+transform caches, and the workspace keeps its FFT adapters (plans and
+buffers); only the per-file state is thrown away between files.
+
+*/
+
+class AnalysisContext {
+public:
+  AnalysisContext();
+  ~AnalysisContext();
+  static AnalysisContext* forCurrentThread();
+  // clears the workspace for a new file, keeping the FFT adapters
+  void reset();
+  KeyFinder::KeyFinder& getKeyFinder();
+  KeyFinder::Workspace& getWorkspace();
+  KeyFinder::AudioData& getDecodeBuffer();
+private:
+  KeyFinder::KeyFinder keyFinder;
+  KeyFinder::Workspace* workspace;
+  KeyFinder::AudioData decodeBuffer;
+  static QThreadStorage<AnalysisContext*> contexts;
+};
+
+#endif // ANALYSISCONTEXT_H
@@ -0,0 +1,107 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "analysislane.h"
+
+AnalysisLane::AnalysisLane(KeyFinder::KeyFinder& kf, KeyFinder::Workspace& w, const Preferences& prefs, bool inOrder, bool s, double startSeconds) :
+  keyFinder(kf), workspace(&w), ownsWorkspace(false), streaming(s),
+  timed(inOrder && prefs.getKeyTimelineSeconds() > 0),
+  stopEarly(inOrder && prefs.getEarlyStop()),
+  secondsAnalysed(startSeconds), secondsAudible(0.0),
+  timeline(kf, prefs.getKeyTimelineSeconds(), startSeconds),
+  convergence(kf, prefs.getEarlyStopMargin() / 100.0, prefs.getEarlyStopSeconds()) { }
+
+AnalysisLane::AnalysisLane(KeyFinder::KeyFinder& kf, const Preferences& prefs, bool inOrder, bool s) :
+  keyFinder(kf), workspace(new KeyFinder::Workspace()), ownsWorkspace(true), streaming(s),
+  timed(inOrder && prefs.getKeyTimelineSeconds() > 0),
+  stopEarly(inOrder && prefs.getEarlyStop()),
+  secondsAnalysed(0.0), secondsAudible(0.0),
+  timeline(kf, prefs.getKeyTimelineSeconds()),
+  convergence(kf, prefs.getEarlyStopMargin() / 100.0, prefs.getEarlyStopSeconds()) { }
+
+AnalysisLane::~AnalysisLane() {
+  if (ownsWorkspace) delete workspace;
+}
+
+const QStringList& AnalysisLane::settingNames() {
+  static const QStringList names = QStringList() << "keyTimelineSeconds" << "earlyStop" << "earlyStopMargin" << "earlyStopSeconds";
+  return names;
+}
+
+void AnalysisLane::analyse(const KeyFinder::AudioData& chunk, double secondsSkipped) {
+  secondsAnalysed += secondsSkipped;
+  if (chunk.getFrameCount() == 0) return;
+  unsigned int hopsBefore = hopsInWorkspace();
+  keyFinder.progressiveChromagram(chunk, *workspace);
+  double seconds = (double) chunk.getFrameCount() / chunk.getFrameRate();
+  secondsAnalysed += seconds;
+  secondsAudible += seconds;
+  if (timed) timeline.addHops(*workspace, hopsBefore, secondsAnalysed);
+  if (stopEarly) convergence.addHops(*workspace, hopsBefore, secondsAudible);
+  if (streaming) accumulator.absorb(*workspace);
+}
+
+bool AnalysisLane::isSatisfied() const {
+  return stopEarly && convergence.hasConverged();
+}
+
+void AnalysisLane::finish() {
+  if (secondsAudible == 0.0) {
+    // all of it gated out; an empty chromagram classifies as silence
+    if (timed) timeline.finish(secondsAnalysed);
+    workspace->chromagram = (streaming ? accumulator.collapse() : new KeyFinder::Chromagram(1));
+    return;
+  }
+  unsigned int hopsBefore = hopsInWorkspace();
+  keyFinder.finalChromagram(*workspace);
+  if (timed) {
+    timeline.addHops(*workspace, hopsBefore, secondsAnalysed);
+    timeline.finish(secondsAnalysed);
+  }
+  if (streaming) {
+    accumulator.absorb(*workspace);
+    workspace->chromagram = accumulator.collapse();
+  }
+}
+
+KeyFinder::key_t AnalysisLane::classify() {
+  return keyFinder.keyOfChromagram(*workspace);
+}
+
+KeyFinder::Workspace& AnalysisLane::getWorkspace() {
+  return *workspace;
+}
+
+const ChromagramAccumulator& AnalysisLane::getAccumulator() const {
+  return accumulator;
+}
+
+const std::vector<KeySegment>& AnalysisLane::getKeyTimeline() const {
+  return timeline.getSegments();
+}
+
+double AnalysisLane::getSecondsAnalysed() const {
+  return secondsAnalysed;
+}
+
+unsigned int AnalysisLane::hopsInWorkspace() const {
+  return (workspace->chromagram == NULL ? 0 : workspace->chromagram->getHops());
+}
@@ -0,0 +1,89 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#ifndef ANALYSISLANE_H
+#define ANALYSISLANE_H
+
+#include <QStringList>
+
+#include <vector>
+
+#include "keyfinder/keyfinder.h"
+#include "keyfinder/audiodata.h"
+
+#include "preferences.h"
+#include "chromagramaccumulator.h"
+#include "keytimeline.h"
+#include "keyconvergence.h"
+
+/*
+
+One analysis of a stream of decoded audio: a workspace, and whatever the
+preferences ask to be worked out alongside its chromagram as chunks arrive
+(the key timeline, convergence for stopping early, a running sum in place
+of the full chromagram when streaming). Several lanes with different
+preferences can be fed the same chunks, so a file decoded once can be
+analysed several ways.
+
+*/
+
+class AnalysisLane {
+public:
+  // inOrder: the audio will arrive front to back, from startSeconds, so
+  // it's meaningful to ask when things happened and whether to stop early
+  AnalysisLane(KeyFinder::KeyFinder&, KeyFinder::Workspace&, const Preferences&, bool inOrder, bool streaming, double startSeconds = 0.0);
+  // as above, with a workspace of its own
+  AnalysisLane(KeyFinder::KeyFinder&, const Preferences&, bool inOrder, bool streaming);
+  ~AnalysisLane();
+  // the settings a lane reads; the rest shape the decode all lanes share,
+  // so are no use in an extra configuration
+  static const QStringList& settingNames();
+  // secondsSkipped: silence taken out since the last chunk, which moves
+  // the timeline on but doesn't count towards the key settling
+  void analyse(const KeyFinder::AudioData&, double secondsSkipped = 0.0);
+  // true once the lane wants no more audio
+  bool isSatisfied() const;
+  // completes the chromagram, which is a single hop if streaming
+  void finish();
+  KeyFinder::key_t classify();
+  KeyFinder::Workspace& getWorkspace();
+  const ChromagramAccumulator& getAccumulator() const;
+  const std::vector<KeySegment>& getKeyTimeline() const;
+  double getSecondsAnalysed() const;
+private:
+  AnalysisLane(const AnalysisLane&);
+  AnalysisLane& operator=(const AnalysisLane&);
+  unsigned int hopsInWorkspace() const;
+  KeyFinder::KeyFinder& keyFinder;
+  KeyFinder::Workspace* workspace;
+  bool ownsWorkspace;
+  bool streaming;
+  bool timed;
+  bool stopEarly;
+  double secondsAnalysed;
+  double secondsAudible;
+  ChromagramAccumulator accumulator;
+  KeyTimeline timeline;
+  KeyConvergence convergence;
+};
+
+#endif // ANALYSISLANE_H
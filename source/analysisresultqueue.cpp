@@ -0,0 +1,47 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "analysisresultqueue.h"
+
+AnalysisResultQueue::AnalysisResultQueue(QObject* parent) : QObject(parent) { }
+
+void AnalysisResultQueue::push(std::unique_ptr<KeyFinderResultWrapper> result) {
+  bool wasEmpty;
+  {
+    QMutexLocker locker(&mutex);
+    wasEmpty = results.empty();
+    results.push_back(std::move(result));
+  }
+  if (wasEmpty) emit resultsReady();
+}
+
+std::unique_ptr<KeyFinderResultWrapper> AnalysisResultQueue::take() {
+  QMutexLocker locker(&mutex);
+  if (results.empty()) return std::unique_ptr<KeyFinderResultWrapper>();
+  std::unique_ptr<KeyFinderResultWrapper> result = std::move(results.front());
+  results.pop_front();
+  return result;
+}
+
+unsigned int AnalysisResultQueue::size() const {
+  QMutexLocker locker(&mutex);
+  return results.size();
+}
@@ -0,0 +1,59 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#ifndef ANALYSISRESULTQUEUE_H
+#define ANALYSISRESULTQUEUE_H
+
+#include <QObject>
+#include <QMutex>
+
+#include <deque>
+#include <memory>
+
+#include "asynckeyresult.h"
+
+/*
+
+Hands analysis results from worker threads to the GUI. Each result is
+moved in once and moved out once, so nothing holds on to it after the
+consumer has taken it; unlike a QFuture's result store, the queue stays
+empty however long the batch. resultsReady() is emitted when the queue
+goes from empty to non-empty, so a queued connection wakes the consumer
+once per backlog rather than once per result.
+
+*/
+
+class AnalysisResultQueue : public QObject {
+  Q_OBJECT
+public:
+  AnalysisResultQueue(QObject* parent = NULL);
+  void push(std::unique_ptr<KeyFinderResultWrapper> result);
+  // NULL once the queue is empty
+  std::unique_ptr<KeyFinderResultWrapper> take();
+  unsigned int size() const;
+signals:
+  void resultsReady();
+private:
+  mutable QMutex mutex;
+  std::deque<std::unique_ptr<KeyFinderResultWrapper> > results;
+};
+
+#endif // ANALYSISRESULTQUEUE_H
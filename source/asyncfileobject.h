@@ -24,13 +24,39 @@
 
 #include <QString>
 #include "preferences.h"
+#include "fileprefetcher.h"
+#include "analysisresultqueue.h"
+
+// how much of the analysis a consumer wants back, beyond the key
+enum result_payload_t {
+  RESULT_PAYLOAD_KEY,
+  RESULT_PAYLOAD_SUMMARY,   // plus the mean magnitude of each chromagram band
+  RESULT_PAYLOAD_CHROMAGRAM // plus a copy of the whole final chromagram
+};
+
+// part of a file with a result of its own, e.g. a track of a CUE sheet
+class TrackRange {
+public:
+  TrackRange(double start, double end, int row) : startSeconds(start), endSeconds(end), batchRow(row) { }
+  double startSeconds;
+  double endSeconds; // negative for the end of the file
+  int batchRow;
+};
 
 class AsyncFileObject {
 public:
-  AsyncFileObject(const QString& path, const Preferences& p, int row) : filePath(path), prefs(p), batchRow(row) { }
+  AsyncFileObject(const QString& path, const Preferences& p, int row, FilePrefetcher* f = NULL, int i = -1) : filePath(path), prefs(p), batchRow(row), prefetcher(f), prefetchIndex(i), payload(RESULT_PAYLOAD_KEY), resultQueue(NULL) { }
   QString filePath;
   Preferences prefs;
   int batchRow;
+  FilePrefetcher* prefetcher; // NULL unless the batch is reading ahead
+  int prefetchIndex;
+  result_payload_t payload;
+  AnalysisResultQueue* resultQueue; // only for queuedKeyDetectionProcess
+  // further analysis settings to try on the same decoded audio
+  QList<Preferences> configurations;
+  // only for trackKeyDetectionProcess
+  QList<TrackRange> tracks;
 };
 
 #endif // ASYNCFILEOBJECT_H
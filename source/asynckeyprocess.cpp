@@ -21,15 +21,187 @@
 
 #include "asynckeyprocess.h"
 
+// chunks in flight between the decoding and analysing threads of one file
+const unsigned int PIPELINE_SLOTS = 4;
+
+// pipelined decoders get their own threads; if they had to queue behind
+// analysis jobs in the global pool, those jobs could wait on them forever
+static QThreadPool* pipelineDecodePool() {
+  static QThreadPool pool;
+  return &pool;
+}
+
+static void decodeIntoRing(AudioDecoder* decoder, SpscRingBuffer<KeyFinder::AudioData>* ring, unsigned int chunkFrames, QString* error) {
+  try {
+    KeyFinder::AudioData* slot;
+    while ((slot = ring->waitForWriteSlot()) != NULL) {
+      if (!decoder->decodeNextAudioChunk(*slot, chunkFrames)) break;
+      ring->publish();
+    }
+  } catch (std::exception& e) {
+    *error = QString(e.what());
+  } catch (...) {
+    *error = "Unknown exception while decoding";
+  }
+  ring->close();
+}
+
+static SilenceGate* silenceGateFor(const Preferences& prefs) {
+  return (prefs.getSilenceGate() ? new SilenceGate(prefs.getSilenceThreshold()) : NULL);
+}
+
+// gates a chunk, if there's a gate, and feeds what's left to each lane
+// still wanting audio; true once none do
+static bool analyseInLanes(const std::vector<AnalysisLane*>& lanes, KeyFinder::AudioData& chunk, SilenceGate* gate) {
+  double secondsSkipped = (gate == NULL ? 0.0 : (double) gate->apply(chunk) / chunk.getFrameRate());
+  bool satisfied = true;
+  for (unsigned int l = 0; l < lanes.size(); l++) {
+    if (lanes[l]->isSatisfied()) continue;
+    lanes[l]->analyse(chunk, secondsSkipped);
+    satisfied = satisfied && lanes[l]->isSatisfied();
+  }
+  return satisfied;
+}
+
+// fast scan windows are evenly spaced, each centred in its share of the file
+static double fastScanWindowStart(int window, int windows, int windowSeconds, double duration) {
+  return duration * (window + 0.5) / windows - windowSeconds / 2.0;
+}
+
+// decoded and thrown away before each part of a split file, so that the
+// decoder and decimator have settled by the time the part proper begins
+const double PART_PREROLL_SECONDS = 2.0;
+// no point splitting a file into parts shorter than this
+const double MIN_PART_SECONDS = 60.0;
+
+// same reasoning as the pipelined decoders: parts get their own threads so
+// the file's job, waiting on them in the global pool, can't starve them
+static QThreadPool* partPool() {
+  static QThreadPool pool;
+  return &pool;
+}
+
+class FilePart {
+public:
+  const AsyncFileObject* object;
+  double startSeconds;
+  double endSeconds; // negative for the end of the file
+  ChromagramAccumulator accumulator;
+  std::vector<KeySegment> timeline;
+  quint64 samplesSkipped;
+  QString errorMessage;
+};
+
+static void analysePart(FilePart* part) {
+  const Preferences& prefs = part->object->prefs;
+  AudioDecoder* decoder = NULL;
+  try {
+    AudioDecoderFactory factory;
+    decoder = factory.createAudioDecoder(part->object->filePath, NO_MAX_DURATION, prefs.getDecimateInDecoder());
+
+    AnalysisContext* context = AnalysisContext::forCurrentThread();
+    context->reset();
+    KeyFinder::KeyFinder& kf = context->getKeyFinder();
+    KeyFinder::Workspace& workspace = context->getWorkspace();
+    KeyFinder::AudioData* chunk = &context->getDecodeBuffer();
+
+    unsigned int frameRate = decoder->getFrameRate();
+    unsigned int chunkFrames = frameRate * prefs.getDecodeChunkSeconds();
+
+    if (part->startSeconds > 0.0) {
+      double prerollStart = std::max(0.0, part->startSeconds - PART_PREROLL_SECONDS);
+      if (!decoder->seekToSeconds(prerollStart)) throw KeyFinder::Exception("Could not seek to part of file");
+      unsigned int preroll = (unsigned int) ((part->startSeconds - prerollStart) * frameRate);
+      while (preroll > 0 && decoder->decodeNextAudioChunk(*chunk, std::min(chunkFrames, preroll))) {
+        preroll -= std::min(preroll, chunk->getFrameCount());
+      }
+    }
+
+    // parts are always streamed, so they can be merged hop-weighted, and
+    // always decoded to the end: a part settling says nothing about the
+    // file, so early stopping doesn't apply
+    Preferences partPrefs(prefs);
+    partPrefs.setEarlyStop(false);
+    AnalysisLane lane(kf, workspace, partPrefs, true, true, part->startSeconds);
+    std::vector<AnalysisLane*> lanes(1, &lane);
+    std::unique_ptr<SilenceGate> gate(silenceGateFor(prefs));
+    bool toEnd = part->endSeconds < 0.0;
+    unsigned int remaining = (toEnd ? 0 : (unsigned int) ((part->endSeconds - part->startSeconds) * frameRate));
+    while ((toEnd || remaining > 0) && decoder->decodeNextAudioChunk(*chunk, (toEnd ? chunkFrames : std::min(chunkFrames, remaining)))) {
+      if (!toEnd) remaining -= std::min(remaining, chunk->getFrameCount());
+      analyseInLanes(lanes, *chunk, gate.get());
+    }
+    delete decoder;
+    decoder = NULL;
+
+    lane.finish();
+    part->accumulator = lane.getAccumulator();
+    part->timeline = lane.getKeyTimeline();
+    part->samplesSkipped = (gate ? gate->getSamplesSkipped() : 0);
+
+  } catch (std::exception& e) {
+    part->errorMessage = QString(e.what());
+  } catch (...) {
+    part->errorMessage = "Unknown exception while analysing part of file";
+  }
+  delete decoder;
+}
+
+// splits the file into consecutive parts analysed side by side, then leaves
+// their combined chromagram in the workspace
+static void analyseInParts(const AsyncFileObject& object, double duration, int parts, KeyFinder::Workspace& workspace, KeyFinderResultWrapper& result) {
+  std::vector<FilePart> fileParts(parts);
+  QList<QFuture<void> > futures;
+  for (int p = 0; p < parts; p++) {
+    fileParts[p].object = &object;
+    fileParts[p].startSeconds = duration * p / parts;
+    fileParts[p].endSeconds = (p == parts - 1 ? -1.0 : duration * (p + 1) / parts);
+    fileParts[p].samplesSkipped = 0;
+    futures.push_back(QtConcurrent::run(partPool(), analysePart, &fileParts[p]));
+  }
+  for (int p = 0; p < parts; p++) futures[p].waitForFinished();
+
+  ChromagramAccumulator whole;
+  for (int p = 0; p < parts; p++) {
+    if (!fileParts[p].errorMessage.isEmpty()) throw KeyFinder::Exception(fileParts[p].errorMessage.toUtf8().constData());
+    whole.merge(fileParts[p].accumulator);
+    KeyTimeline::append(result.keyTimeline, fileParts[p].timeline);
+    result.samplesSkipped += fileParts[p].samplesSkipped;
+  }
+  delete workspace.chromagram;
+  workspace.chromagram = whole.collapse();
+}
+
 KeyFinderResultWrapper keyDetectionProcess(const AsyncFileObject& object) {
 
   KeyFinderResultWrapper result;
   result.batchRow = object.batchRow;
 
-  AudioFileDecoder* decoder = NULL;
+  if (object.prefetcher != NULL) object.prefetcher->beginFile(object.prefetchIndex);
+
+  // a file that hasn't changed since it was analysed with the same settings
+  // needn't be decoded again; the cache only holds keys, though
+  bool cached = object.prefs.getResultCache();
+  bool storing = object.prefs.getStoreChromagrams();
+  QByteArray identity;
+  if (cached) identity = ResultCache::fileIdentity(object.filePath, object.prefs.getResultCacheHash());
+  if (cached && object.payload == RESULT_PAYLOAD_KEY && object.configurations.isEmpty() && (!storing || ChromagramStore::getInstance()->contains(object.filePath))) {
+    if (ResultCache::getInstance()->lookup(identity, object.prefs, result)) return result;
+  }
+
+  QElapsedTimer openTimer;
+  openTimer.start();
+
+  // when streaming, nothing's too long: files over the limit are analysed
+  // without keeping their chromagram
+  int maxDuration = (object.prefs.getStreamLongFiles() ? NO_MAX_DURATION : object.prefs.getMaxDuration());
+
+  AudioDecoder* decoder = NULL;
   try {
 
-    decoder = new AudioFileDecoder(object.filePath, object.prefs.getMaxDuration());
+    AudioDecoderFactory factory;
+    decoder = factory.createAudioDecoder(object.filePath, maxDuration, object.prefs.getDecimateInDecoder());
+    if (object.prefetcher != NULL) object.prefetcher->recordOpen(openTimer.elapsed());
 
   } catch (std::exception& e) {
 
@@ -44,27 +216,124 @@ KeyFinderResultWrapper keyDetectionProcess(const AsyncFileObject& object) {
     return result;
   }
 
-  KeyFinder::Workspace workspace;
+  // FFTW's planner isn't thread-safe, so let any warm-up finish first
+  FftwWisdom::waitForWarmUp();
 
-  static KeyFinder::KeyFinder kf;
+  // this thread's KeyFinder, workspace and decode buffer, reused file to file
+  AnalysisContext* context = AnalysisContext::forCurrentThread();
+  context->reset();
+  KeyFinder::KeyFinder& kf = context->getKeyFinder();
+  KeyFinder::Workspace& workspace = context->getWorkspace();
+  KeyFinder::AudioData* chunk = &context->getDecodeBuffer();
 
   try {
 
-    while (true) {
+    unsigned int chunkFrames = decoder->getFrameRate() * object.prefs.getDecodeChunkSeconds();
 
-      KeyFinder::AudioData* tempAudio = decoder->decodeNextAudioPacket();
-      if (tempAudio == NULL) break;
+    // fast scan: evenly spaced windows only, stitched together into one
+    // chromagram. Not worth it unless they'd cover well under the whole file.
+    int windows = object.prefs.getFastScanWindows();
+    int windowSeconds = object.prefs.getFastScanWindowSeconds();
+    double duration = decoder->getDurationSeconds();
+    bool fastScan = object.prefs.getFastScan() && windows > 0 && windows * windowSeconds < duration * 0.75;
+    // a file that can't be sought through (a stream, or a container without
+    // an index) is decoded whole instead. Nothing has been decoded yet, so a
+    // failed seek leaves it at the start.
+    bool unseekable = fastScan && !decoder->seekToSeconds(fastScanWindowStart(0, windows, windowSeconds, duration));
+    if (unseekable) fastScan = false;
 
-      kf.progressiveChromagram(*tempAudio, workspace);
-      delete tempAudio;
+    // long files are split into parts analysed side by side, so one file
+    // doesn't keep a single core busy long after the rest of a batch is done
+    int parallelMinutes = object.prefs.getParallelChunkMinutes();
+    int parts = std::min(QThread::idealThreadCount(), (int) (duration / MIN_PART_SECONDS));
+    bool split = !fastScan && !unseekable && object.configurations.isEmpty() && parallelMinutes > 0 && duration > parallelMinutes * 60.0 && parts > 1;
+
+    bool streaming = !split && object.prefs.getStreamLongFiles() && duration > object.prefs.getMaxDuration() * 60.0;
+
+    // the primary lane, plus one for each extra configuration, all fed the
+    // same chunks. Timelines and early stopping need the audio in order, so
+    // fast scans don't get them; split files put theirs together from their
+    // parts'.
+    AnalysisLane primary(kf, workspace, object.prefs, !fastScan && !split, streaming);
+    std::vector<AnalysisLane*> lanes(1, &primary);
+    std::vector<std::unique_ptr<AnalysisLane> > extraLanes;
+    for (int c = 0; c < object.configurations.size(); c++) {
+      extraLanes.push_back(std::unique_ptr<AnalysisLane>(new AnalysisLane(kf, object.configurations[c], !fastScan, streaming)));
+      lanes.push_back(extraLanes.back().get());
+    }
+    // silence is a property of the audio, so one gate serves every lane
+    std::unique_ptr<SilenceGate> gate(silenceGateFor(object.prefs));
+
+    if (fastScan) {
+      unsigned int windowFrames = decoder->getFrameRate() * windowSeconds;
+      for (int w = 0; w < windows; w++) {
+        // the first window has already been sought to
+        if (w > 0 && !decoder->seekToSeconds(fastScanWindowStart(w, windows, windowSeconds, duration))) break;
+        unsigned int remaining = windowFrames;
+        while (remaining > 0 && decoder->decodeNextAudioChunk(*chunk, std::min(chunkFrames, remaining))) {
+          remaining -= std::min(remaining, chunk->getFrameCount());
+          analyseInLanes(lanes, *chunk, gate.get());
+        }
+      }
+    } else if (split) {
+      delete decoder; // each part opens its own
+      decoder = NULL;
+      analyseInParts(object, duration, parts, workspace, result);
+    } else if (object.prefs.getPipelineDecode()) {
+      // decode on another thread while this one analyses what's ready
+      SpscRingBuffer<KeyFinder::AudioData> ring(PIPELINE_SLOTS);
+      QString decodeError;
+      QFuture<void> producer = QtConcurrent::run(pipelineDecodePool(), decodeIntoRing, decoder, &ring, chunkFrames, &decodeError);
+      try {
+        KeyFinder::AudioData* slot;
+        while ((slot = ring.waitForReadSlot()) != NULL) {
+          bool satisfied = analyseInLanes(lanes, *slot, gate.get());
+          ring.release();
+          if (satisfied) break;
+        }
+      } catch (...) {
+        ring.cancel();
+        producer.waitForFinished();
+        throw;
+      }
+      ring.cancel(); // no-op unless we stopped early
+      producer.waitForFinished();
+      if (!decodeError.isEmpty()) throw KeyFinder::Exception(decodeError.toUtf8().constData());
+    } else {
+      while (decoder->decodeNextAudioChunk(*chunk, chunkFrames)) {
+        if (analyseInLanes(lanes, *chunk, gate.get())) break;
+      }
     }
 
     delete decoder;
     decoder = NULL;
 
-    kf.finalChromagram(workspace);
-    result.fullChromagram = KeyFinder::Chromagram(*workspace.chromagram);
-    result.core = kf.keyOfChromagram(workspace);
+    if (split) {
+      // every part ran to its end; their timelines and skipped samples have
+      // already been merged into the result
+      result.secondsAnalysed = duration;
+    } else {
+      for (unsigned int l = 0; l < lanes.size(); l++) lanes[l]->finish();
+      result.keyTimeline = primary.getKeyTimeline();
+      result.secondsAnalysed = primary.getSecondsAnalysed();
+      if (gate) result.samplesSkipped = gate->getSamplesSkipped();
+    }
+    result.durationSeconds = duration;
+    if (storing) ChromagramStore::getInstance()->store(object.filePath, workspace.chromagram->collapseToOneHop(), result.secondsAnalysed, duration);
+    if (object.payload == RESULT_PAYLOAD_CHROMAGRAM) {
+      result.fullChromagram = KeyFinder::Chromagram(*workspace.chromagram);
+    } else if (object.payload == RESULT_PAYLOAD_SUMMARY) {
+      result.chromagramSummary = workspace.chromagram->collapseToOneHop();
+    }
+    result.core = primary.classify();
+    for (unsigned int l = 1; l < lanes.size(); l++) {
+      ConfigurationResult configuration;
+      configuration.key = lanes[l]->classify();
+      configuration.keyTimeline = lanes[l]->getKeyTimeline();
+      configuration.secondsAnalysed = lanes[l]->getSecondsAnalysed();
+      result.configurations.push_back(configuration);
+    }
+    if (cached) ResultCache::getInstance()->store(identity, object.prefs, result);
 
   } catch (std::exception& e) {
 
@@ -86,3 +355,145 @@ KeyFinderResultWrapper keyDetectionProcess(const AsyncFileObject& object) {
 
   return result;
 }
+
+// copies some of a chunk's frames into another chunk
+static void copyFrames(const KeyFinder::AudioData& from, unsigned int firstFrame, unsigned int frames, KeyFinder::AudioData& to) {
+  unsigned int channels = from.getChannels();
+  to = KeyFinder::AudioData();
+  to.setChannels(channels);
+  to.setFrameRate(from.getFrameRate());
+  to.addToSampleCount(frames * channels);
+  to.resetIterators();
+  for (unsigned int i = 0; i < frames * channels; i++) {
+    to.setSampleAtWriteIterator(from.getSample(firstFrame * channels + i));
+    to.advanceWriteIterator();
+  }
+}
+
+static void finishTrack(AnalysisLane& lane, double durationSeconds, quint64 samplesSkipped, KeyFinderResultWrapper& result) {
+  lane.finish();
+  result.core = lane.classify();
+  result.keyTimeline = lane.getKeyTimeline();
+  result.secondsAnalysed = lane.getSecondsAnalysed();
+  result.durationSeconds = durationSeconds;
+  result.samplesSkipped = samplesSkipped;
+}
+
+// tracks are taken not to overlap, as in a CUE sheet
+std::vector<KeyFinderResultWrapper> trackKeyDetectionProcess(const AsyncFileObject& object) {
+
+  int trackCount = object.tracks.size();
+  std::vector<KeyFinderResultWrapper> results(trackCount);
+  for (int t = 0; t < trackCount; t++) results[t].batchRow = object.tracks[t].batchRow;
+
+  if (object.prefetcher != NULL) object.prefetcher->beginFile(object.prefetchIndex);
+
+  AudioDecoder* decoder = NULL;
+  try {
+
+    // an image is as long as an album; it's each track that's analysed
+    AudioDecoderFactory factory;
+    decoder = factory.createAudioDecoder(object.filePath, NO_MAX_DURATION, object.prefs.getDecimateInDecoder());
+
+    FftwWisdom::waitForWarmUp();
+    AnalysisContext* context = AnalysisContext::forCurrentThread();
+    context->reset();
+    KeyFinder::KeyFinder& kf = context->getKeyFinder();
+    KeyFinder::AudioData* chunk = &context->getDecodeBuffer();
+    KeyFinder::AudioData piece;
+
+    unsigned int frameRate = decoder->getFrameRate();
+    unsigned int chunkFrames = frameRate * object.prefs.getDecodeChunkSeconds();
+    double maxSeconds = object.prefs.getMaxDuration() * 60.0;
+
+    std::vector<quint64> firstFrames(trackCount);
+    std::vector<quint64> endFrames(trackCount);
+    std::vector<quint64> samplesSkipped(trackCount, 0);
+    std::vector<bool> done(trackCount, false);
+    for (int t = 0; t < trackCount; t++) {
+      firstFrames[t] = (quint64) (object.tracks[t].startSeconds * frameRate + 0.5);
+      endFrames[t] = (object.tracks[t].endSeconds < 0.0 ? std::numeric_limits<quint64>::max() : (quint64) (object.tracks[t].endSeconds * frameRate + 0.5));
+    }
+
+    // a lane per track, opened when the decode reaches it and closed once
+    // it's past, so only the tracks under way hold a workspace
+    std::vector<std::unique_ptr<AnalysisLane> > lanes(trackCount);
+    std::unique_ptr<SilenceGate> gate(silenceGateFor(object.prefs));
+    quint64 position = 0;
+    int tracksLeft = trackCount;
+
+    while (tracksLeft > 0 && decoder->decodeNextAudioChunk(*chunk, chunkFrames)) {
+      quint64 chunkStart = position;
+      quint64 chunkEnd = position + chunk->getFrameCount();
+      position = chunkEnd;
+      for (int t = 0; t < trackCount; t++) {
+        if (done[t] || firstFrames[t] >= chunkEnd || endFrames[t] <= chunkStart) continue;
+        if (!lanes[t]) {
+          double seconds = (endFrames[t] == std::numeric_limits<quint64>::max() ? decoder->getDurationSeconds() : object.tracks[t].endSeconds) - object.tracks[t].startSeconds;
+          lanes[t].reset(new AnalysisLane(kf, object.prefs, true, seconds > maxSeconds));
+        }
+        if (lanes[t]->isSatisfied()) continue;
+        quint64 first = std::max(firstFrames[t], chunkStart);
+        quint64 end = std::min(endFrames[t], chunkEnd);
+        // the common case, a chunk inside one track, needn't be copied
+        KeyFinder::AudioData* audio = chunk;
+        if (first > chunkStart || end < chunkEnd) {
+          copyFrames(*chunk, (unsigned int) (first - chunkStart), (unsigned int) (end - first), piece);
+          audio = &piece;
+        }
+        double secondsSkipped = 0.0;
+        if (gate) {
+          unsigned int channels = audio->getChannels();
+          unsigned int dropped = gate->apply(*audio);
+          samplesSkipped[t] += (quint64) dropped * channels;
+          secondsSkipped = (double) dropped / audio->getFrameRate();
+        }
+        lanes[t]->analyse(*audio, secondsSkipped);
+      }
+      // classify the tracks the decode has got past
+      for (int t = 0; t < trackCount; t++) {
+        if (done[t] || !lanes[t] || endFrames[t] > chunkEnd) continue;
+        finishTrack(*lanes[t], (double) (endFrames[t] - firstFrames[t]) / frameRate, samplesSkipped[t], results[t]);
+        lanes[t].reset();
+        done[t] = true;
+        tracksLeft--;
+      }
+    }
+    delete decoder;
+    decoder = NULL;
+
+    // the rest run to the end of the file, or start after it
+    for (int t = 0; t < trackCount; t++) {
+      if (done[t]) continue;
+      if (!lanes[t]) {
+        results[t].errorMessage = "Track starts after the end of the file";
+        continue;
+      }
+      finishTrack(*lanes[t], (double) (position - firstFrames[t]) / frameRate, samplesSkipped[t], results[t]);
+    }
+
+  } catch (std::exception& e) {
+
+    delete decoder;
+    for (int t = 0; t < trackCount; t++) results[t].errorMessage = QString(e.what());
+
+  } catch (...) {
+
+    delete decoder;
+    for (int t = 0; t < trackCount; t++) results[t].errorMessage = "Unknown exception while analysing tracks";
+  }
+
+  return results;
+}
+
+void queuedKeyDetectionProcess(const AsyncFileObject& object) {
+  if (!object.tracks.isEmpty()) {
+    std::vector<KeyFinderResultWrapper> results = trackKeyDetectionProcess(object);
+    for (unsigned int t = 0; t < results.size(); t++) {
+      object.resultQueue->push(std::unique_ptr<KeyFinderResultWrapper>(new KeyFinderResultWrapper(std::move(results[t]))));
+    }
+    return;
+  }
+  std::unique_ptr<KeyFinderResultWrapper> result(new KeyFinderResultWrapper(keyDetectionProcess(object)));
+  object.resultQueue->push(std::move(result));
+}
@@ -24,19 +24,38 @@
 
 #include <QFile>
 #include <QString>
+#include <QElapsedTimer>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
 
 #include <vector>
+#include <memory>
+#include <limits>
 
 #include "keyfinder/keyfinder.h"
 #include "keyfinder/exception.h"
 #include "keyfinder/audiodata.h"
 
 #include "preferences.h"
-#include "decoderlibav.h"
+#include "analysiscontext.h"
+#include "fftwwisdom.h"
+#include "audiodecoderfactory.h"
+#include "spscringbuffer.h"
+#include "chromagramaccumulator.h"
+#include "analysislane.h"
+#include "keytimeline.h"
+#include "keyconvergence.h"
+#include "silencegate.h"
+#include "resultcache.h"
+#include "chromagramstore.h"
 #include "asyncfileobject.h"
 #include "asynckeyresult.h"
 
 // trying this as a global function rather than an object...
 KeyFinderResultWrapper keyDetectionProcess(const AsyncFileObject&);
+// one decode of the file, with a key for each of its tracks
+std::vector<KeyFinderResultWrapper> trackKeyDetectionProcess(const AsyncFileObject&);
+// as above, but the results are moved into the object's result queue
+void queuedKeyDetectionProcess(const AsyncFileObject&);
 
 #endif // KEYFINDERMODEL_H
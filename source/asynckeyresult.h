@@ -23,12 +23,30 @@
 #define KEYFINDERRESULTWRAPPER_H
 
 #include <QString>
+#include <vector>
 #include <keyfinder/keyfinder.h>
+#include "keytimeline.h"
+
+// what one of the extra configurations made of the same decoded audio
+class ConfigurationResult {
+public:
+  ConfigurationResult() : key(KeyFinder::SILENCE), secondsAnalysed(0.0) { }
+  KeyFinder::key_t key;
+  std::vector<KeySegment> keyTimeline; // empty unless its keyTimelineSeconds > 0
+  double secondsAnalysed; // less than the file's after an early stop
+};
 
 class KeyFinderResultWrapper {
 public:
+  KeyFinderResultWrapper() : core(KeyFinder::SILENCE), secondsAnalysed(0.0), durationSeconds(0.0), samplesSkipped(0), batchRow(-1) { }
   KeyFinder::key_t core;
-  KeyFinder::Chromagram fullChromagram;
+  KeyFinder::Chromagram fullChromagram; // empty unless RESULT_PAYLOAD_CHROMAGRAM
+  std::vector<double> chromagramSummary; // empty unless RESULT_PAYLOAD_SUMMARY
+  std::vector<KeySegment> keyTimeline;   // empty unless keyTimelineSeconds > 0
+  double secondsAnalysed; // less than durationSeconds after a fast scan or early stop
+  double durationSeconds;
+  quint64 samplesSkipped; // silent samples, as analysed, kept from the chromagram
+  std::vector<ConfigurationResult> configurations; // one per extra configuration
   int batchRow;
   QString errorMessage;
 };
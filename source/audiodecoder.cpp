@@ -0,0 +1,42 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#include "audiodecoder.h"
+
+AudioDecoder::~AudioDecoder() { }
+
+void AudioDecoder::fillChunk(KeyFinder::AudioData& chunk, const double* samples, unsigned int sampleCount) const {
+  // the caller's buffer only grows if it's too small; every sample gets
+  // overwritten, so a short final chunk just trims from the front
+  if (chunk.getSampleCount() > sampleCount) {
+    chunk.setChannels(1);
+    chunk.discardFramesFromFront(chunk.getSampleCount() - sampleCount);
+  }
+  if (chunk.getSampleCount() < sampleCount) chunk.addToSampleCount(sampleCount - chunk.getSampleCount());
+  chunk.setFrameRate(getFrameRate());
+  chunk.setChannels(getChannels());
+  chunk.resetIterators();
+  for (unsigned int i = 0; i < sampleCount; i++) {
+    chunk.setSampleAtWriteIterator(samples[i]);
+    chunk.advanceWriteIterator();
+  }
+}
@@ -0,0 +1,52 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#ifndef AUDIODECODER_H
+#define AUDIODECODER_H
+
+#include "keyfinder/audiodata.h"
+
+/*
+
+Anything that can turn a file into chunks of audio for analysis. The libav
+decoder handles every format; uncompressed PCM gets a faster path of its own.
+
+*/
+
+// in place of a maximum duration in minutes, for decoders that needn't reject anything
+const int NO_MAX_DURATION = -1;
+
+class AudioDecoder {
+public:
+  virtual ~AudioDecoder();
+  // fills a caller-owned buffer with up to chunkFrames frames; false at EOF
+  virtual bool decodeNextAudioChunk(KeyFinder::AudioData&, unsigned int) = 0;
+  virtual unsigned int getFrameRate() const = 0;
+  virtual unsigned int getChannels() const = 0;
+  virtual double getDurationSeconds() const = 0;
+  // repositions the decoder; chunks then continue from (roughly) here
+  virtual bool seekToSeconds(double) = 0;
+protected:
+  void fillChunk(KeyFinder::AudioData&, const double*, unsigned int) const;
+};
+
+#endif // AUDIODECODER_H
@@ -0,0 +1,34 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "audiodecoderfactory.h"
+
+AudioDecoder* AudioDecoderFactory::createAudioDecoder(const QString& filePath, const int maxDuration, bool downmixAndDecimate) const {
+  // uncompressed files are read directly if their layout is one we know;
+  // anything else (and anything odd) goes through libav
+  QString extension = QFileInfo(filePath).suffix().toLower();
+  if (extension == "wav" || extension == "aif" || extension == "aiff" || extension == "aifc") {
+    PcmFileDecoder* pcm = new PcmFileDecoder(filePath, maxDuration, downmixAndDecimate);
+    if (pcm->isOpen()) return pcm;
+    delete pcm;
+  }
+  return new AudioFileDecoder(filePath, maxDuration, downmixAndDecimate);
+}
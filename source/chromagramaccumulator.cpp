@@ -0,0 +1,59 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#include "chromagramaccumulator.h"
+
+ChromagramAccumulator::ChromagramAccumulator() : hops(0) { }
+
+void ChromagramAccumulator::absorb(KeyFinder::Workspace& workspace) {
+  KeyFinder::Chromagram* c = workspace.chromagram;
+  if (c == NULL) return;
+  if (sums.size() < c->getBands()) sums.resize(c->getBands(), 0.0);
+  for (unsigned int h = 0; h < c->getHops(); h++) {
+    for (unsigned int b = 0; b < c->getBands(); b++) {
+      sums[b] += c->getMagnitude(h, b);
+    }
+  }
+  hops += c->getHops();
+  delete c;
+  workspace.chromagram = NULL;
+}
+
+void ChromagramAccumulator::merge(const ChromagramAccumulator& that) {
+  if (sums.size() < that.sums.size()) sums.resize(that.sums.size(), 0.0);
+  for (unsigned int b = 0; b < that.sums.size(); b++) {
+    sums[b] += that.sums[b];
+  }
+  hops += that.hops;
+}
+
+unsigned int ChromagramAccumulator::getHops() const {
+  return hops;
+}
+
+KeyFinder::Chromagram* ChromagramAccumulator::collapse() const {
+  KeyFinder::Chromagram* c = new KeyFinder::Chromagram(1);
+  for (unsigned int b = 0; b < sums.size() && b < c->getBands(); b++) {
+    c->setMagnitude(0, b, (hops > 0 ? sums[b] / hops : 0.0));
+  }
+  return c;
+}
@@ -0,0 +1,54 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#ifndef CHROMAGRAMACCUMULATOR_H
+#define CHROMAGRAMACCUMULATOR_H
+
+#include <vector>
+
+#include "keyfinder/keyfinder.h"
+
+/*
+
+Constant-memory stand-in for a workspace's growing chromagram. Key
+classification only looks at the chromagram averaged over time, so the hops
+can be summed as they're produced and then thrown away; what's left at the
+end is a single hop with the same average, whatever the file's length.
+
+*/
+
+class ChromagramAccumulator {
+public:
+  ChromagramAccumulator();
+  // folds in the workspace's chromagram, leaving the workspace without one
+  void absorb(KeyFinder::Workspace&);
+  // folds in another accumulator's hops, e.g. from another part of the file
+  void merge(const ChromagramAccumulator&);
+  unsigned int getHops() const;
+  // a one-hop chromagram of the mean; caller takes ownership
+  KeyFinder::Chromagram* collapse() const;
+private:
+  std::vector<double> sums;
+  unsigned int hops;
+};
+
+#endif // CHROMAGRAMACCUMULATOR_H
@@ -0,0 +1,198 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "chromagramstore.h"
+
+#include <cstring>
+
+const char* STORE_MAGIC = "KFCS";
+const quint32 STORE_FORMAT_VERSION = 2;
+const int STORE_STREAM_VERSION = QDataStream::Qt_5_0;
+const int STORE_LOCK_TIMEOUT = 5000; // ms
+const double QUANTISATION_STEPS = 65535.0;
+
+ChromagramStore::ChromagramStore(const QString& p) : path(p), loaded(false) { }
+
+ChromagramStore* ChromagramStore::getInstance() {
+  static ChromagramStore instance(storePath());
+  return &instance;
+}
+
+QString ChromagramStore::storePath() {
+  return QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/chromagrams.store";
+}
+
+void ChromagramStore::store(const QString& filePath, const std::vector<double>& bands, double secondsAnalysed, double durationSeconds) {
+  QString canonical = QFileInfo(filePath).canonicalFilePath();
+  if (canonical.isEmpty() || bands.empty()) return;
+  Record record = quantise(bands);
+  record.identity = ResultCache::fileIdentity(canonical, false);
+  record.secondsAnalysed = secondsAnalysed;
+  record.durationSeconds = durationSeconds;
+
+  QMutexLocker locker(&mutex);
+  load();
+  records.insert(canonical, record);
+  QLockFile lock(path + ".lock");
+  if (!lock.tryLock(STORE_LOCK_TIMEOUT)) {
+    qWarning("Chromagram store %s is locked, not writing to it", path.toLocal8Bit().constData());
+    return;
+  }
+  QFile file(path);
+  if (!file.open(QIODevice::Append)) {
+    qWarning("Could not write to chromagram store %s", path.toLocal8Bit().constData());
+    return;
+  }
+  QDataStream out(&file);
+  out.setVersion(STORE_STREAM_VERSION);
+  out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+  if (file.size() == 0) {
+    out.writeRawData(STORE_MAGIC, 4);
+    out << STORE_FORMAT_VERSION;
+  }
+  writeRecord(out, canonical, record);
+}
+
+bool ChromagramStore::contains(const QString& filePath) {
+  QString canonical = QFileInfo(filePath).canonicalFilePath();
+  QMutexLocker locker(&mutex);
+  load();
+  QHash<QString, Record>::const_iterator it = records.constFind(canonical);
+  return it != records.constEnd() && isCurrent(canonical, it.value());
+}
+
+std::vector<double> ChromagramStore::retrieve(const QString& filePath) {
+  QString canonical = QFileInfo(filePath).canonicalFilePath();
+  QMutexLocker locker(&mutex);
+  load();
+  QHash<QString, Record>::const_iterator it = records.constFind(canonical);
+  if (it == records.constEnd() || !isCurrent(canonical, it.value())) return std::vector<double>();
+  return dequantise(it.value());
+}
+
+unsigned int ChromagramStore::size() {
+  QMutexLocker locker(&mutex);
+  load();
+  return records.size();
+}
+
+QMap<QString, ChromagramStore::Classification> ChromagramStore::reclassify(KeyFinder::KeyFinder& kf) {
+  QMutexLocker locker(&mutex);
+  load();
+  QMap<QString, Classification> keys;
+  KeyFinder::Workspace workspace;
+  for (QHash<QString, Record>::const_iterator it = records.constBegin(); it != records.constEnd(); ++it) {
+    if (!isCurrent(it.key(), it.value())) continue;
+    std::vector<double> bands = dequantise(it.value());
+    delete workspace.chromagram;
+    workspace.chromagram = new KeyFinder::Chromagram(1);
+    for (unsigned int b = 0; b < bands.size() && b < workspace.chromagram->getBands(); b++) {
+      workspace.chromagram->setMagnitude(0, b, bands[b]);
+    }
+    Classification c;
+    c.key = kf.keyOfChromagram(workspace);
+    c.secondsAnalysed = it->secondsAnalysed;
+    c.durationSeconds = it->durationSeconds;
+    keys.insert(it.key(), c);
+  }
+  return keys;
+}
+
+bool ChromagramStore::isCurrent(const QString& canonical, const Record& record) {
+  return record.identity == ResultCache::fileIdentity(canonical, false);
+}
+
+ChromagramStore::Record ChromagramStore::quantise(const std::vector<double>& bands) {
+  Record record;
+  double loudest = 0.0;
+  for (unsigned int b = 0; b < bands.size(); b++) loudest = std::max(loudest, bands[b]);
+  record.scale = (float) loudest;
+  record.bands.resize(bands.size(), 0);
+  if (loudest <= 0.0) return record;
+  for (unsigned int b = 0; b < bands.size(); b++) {
+    record.bands[b] = (quint16) (std::max(0.0, bands[b]) / loudest * QUANTISATION_STEPS + 0.5);
+  }
+  return record;
+}
+
+std::vector<double> ChromagramStore::dequantise(const Record& record) {
+  std::vector<double> bands(record.bands.size());
+  for (unsigned int b = 0; b < bands.size(); b++) {
+    bands[b] = record.bands[b] * (double) record.scale / QUANTISATION_STEPS;
+  }
+  return bands;
+}
+
+void ChromagramStore::load() {
+  if (loaded) return;
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  QLockFile lock(path + ".lock");
+  if (!lock.tryLock(STORE_LOCK_TIMEOUT)) return; // nothing's stored until it can be read
+  loaded = true;
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return;
+  QDataStream in(&file);
+  in.setVersion(STORE_STREAM_VERSION);
+  in.setFloatingPointPrecision(QDataStream::SinglePrecision);
+  char magic[4];
+  quint32 version = 0;
+  bool header = in.readRawData(magic, 4) == 4 && memcmp(magic, STORE_MAGIC, 4) == 0;
+  if (header) in >> version;
+  if (!header || version != STORE_FORMAT_VERSION) {
+    // not ours, or written by another version; start again rather than
+    // append to it
+    qWarning("Discarding chromagram store %s with unknown format", path.toLocal8Bit().constData());
+    file.close();
+    QFile::remove(path);
+    return;
+  }
+  QString filePath;
+  Record record;
+  qint64 goodEnd = file.pos();
+  while (!in.atEnd() && readRecord(in, filePath, record)) {
+    records.insert(filePath, record);
+    goodEnd = file.pos();
+  }
+  // a record cut short by a crash ends the log, and is dropped; the log is
+  // cut back to the last whole record so later ones aren't appended after it
+  qint64 size = file.size();
+  file.close();
+  if (goodEnd < size) {
+    qWarning("Dropping %lld bytes of incomplete record from chromagram store %s", size - goodEnd, path.toLocal8Bit().constData());
+    if (!QFile::resize(path, goodEnd)) QFile::remove(path);
+  }
+}
+
+void ChromagramStore::writeRecord(QDataStream& out, const QString& filePath, const Record& record) {
+  out << filePath << record.identity << record.secondsAnalysed << record.durationSeconds;
+  out << record.scale << (quint16) record.bands.size();
+  for (unsigned int b = 0; b < record.bands.size(); b++) out << record.bands[b];
+}
+
+bool ChromagramStore::readRecord(QDataStream& in, QString& filePath, Record& record) {
+  quint16 count;
+  in >> filePath >> record.identity >> record.secondsAnalysed >> record.durationSeconds;
+  in >> record.scale >> count;
+  if (in.status() != QDataStream::Ok) return false;
+  record.bands.resize(count);
+  for (unsigned int b = 0; b < count; b++) in >> record.bands[b];
+  return in.status() == QDataStream::Ok;
+}
@@ -0,0 +1,101 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#ifndef CHROMAGRAMSTORE_H
+#define CHROMAGRAMSTORE_H
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QLockFile>
+#include <QMap>
+#include <QMutex>
+#include <QStandardPaths>
+#include <QString>
+
+#include <vector>
+
+#include "keyfinder/keyfinder.h"
+
+#include "resultcache.h"
+
+/*
+
+Keeps each analysed file's chromagram, so that keys can be worked out again
+(by a newer libkeyfinder, say) without decoding anything. Classification
+only looks at the chromagram averaged over time, so that's all that's kept:
+one hop, each band quantised to 16 bits against the record's loudest band,
+which with the file's path comes to a few hundred bytes a file. Like the
+result cache, records are held in memory and appended to a versioned log
+under a lock file, later records for a file replacing earlier ones.
+
+Each record carries the file's identity as the result cache works it out,
+so a file that has changed since is passed over rather than given a key it
+no longer has, and how much of the file was analysed, since a fast scan or
+an early stop leaves a partial chromagram.
+
+*/
+
+class ChromagramStore {
+public:
+  class Classification {
+  public:
+    KeyFinder::key_t key;
+    double secondsAnalysed;
+    double durationSeconds;
+  };
+  ChromagramStore(const QString& path);
+  static ChromagramStore* getInstance();
+  static QString storePath();
+  // the mean of each band over the part of the file that was analysed
+  void store(const QString& filePath, const std::vector<double>& bands, double secondsAnalysed, double durationSeconds);
+  // only for the file as it is now
+  bool contains(const QString& filePath);
+  // empty if there's nothing stored for the file as it is now
+  std::vector<double> retrieve(const QString& filePath);
+  unsigned int size();
+  // classifies afresh every stored chromagram whose file hasn't changed, by
+  // canonical path
+  QMap<QString, Classification> reclassify(KeyFinder::KeyFinder&);
+private:
+  class Record {
+  public:
+    QByteArray identity;
+    double secondsAnalysed;
+    double durationSeconds;
+    float scale;
+    std::vector<quint16> bands;
+  };
+  static Record quantise(const std::vector<double>&);
+  static std::vector<double> dequantise(const Record&);
+  static void writeRecord(QDataStream&, const QString&, const Record&);
+  static bool readRecord(QDataStream&, QString&, Record&);
+  static bool isCurrent(const QString& canonical, const Record&);
+  void load();
+  QString path;
+  QMutex mutex;
+  bool loaded;
+  QHash<QString, Record> records;
+};
+
+#endif // CHROMAGRAMSTORE_H
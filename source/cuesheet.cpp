@@ -0,0 +1,142 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "cuesheet.h"
+
+CueSheet::CueSheet(const QString& cuePath) {
+  QFile file(cuePath);
+  if (!file.open(QIODevice::ReadOnly)) {
+    qWarning("Could not open CUE sheet %s", cuePath.toLocal8Bit().constData());
+    return;
+  }
+  QByteArray bytes = file.readAll();
+  // rippers write UTF-8 (perhaps with a BOM) or the system's 8-bit encoding
+  QTextCodec::ConverterState state;
+  QString text = QTextCodec::codecForName("UTF-8")->toUnicode(bytes.constData(), bytes.size(), &state);
+  if (state.invalidChars > 0) text = QString::fromLocal8Bit(bytes);
+  parse(text, QFileInfo(cuePath).absoluteDir());
+}
+
+bool CueSheet::isValid() const {
+  return !tracks.isEmpty();
+}
+
+QString CueSheet::getTitle() const {
+  return title;
+}
+
+QString CueSheet::getPerformer() const {
+  return performer;
+}
+
+const QList<CueTrack>& CueSheet::getTracks() const {
+  return tracks;
+}
+
+void CueSheet::parse(const QString& text, const QDir& directory) {
+  QString currentFile;
+  bool inAudioTrack = false;
+  CueTrack track;
+  // a track's pregap (INDEX 00) ends the track before it, where there is one
+  double pregapStart = -1.0;
+
+  foreach (const QString& line, text.split(QRegExp("[\r\n]"), QString::SkipEmptyParts)) {
+    QStringList words = tokenise(line);
+    if (words.isEmpty()) continue;
+    QString command = words[0].toUpper();
+
+    if (command == "FILE" && words.size() > 1) {
+      if (inAudioTrack && track.startSeconds >= 0.0) tracks.push_back(track);
+      inAudioTrack = false;
+      currentFile = resolveFile(words[1], directory);
+    } else if (command == "TRACK" && words.size() > 2) {
+      if (inAudioTrack && track.startSeconds >= 0.0) tracks.push_back(track);
+      inAudioTrack = words[2].toUpper() == "AUDIO" && !currentFile.isEmpty();
+      track = CueTrack();
+      track.number = words[1].toInt();
+      track.performer = performer;
+      track.filePath = currentFile;
+      track.startSeconds = -1.0;
+      pregapStart = -1.0;
+    } else if (command == "INDEX" && words.size() > 2 && inAudioTrack) {
+      double seconds = parseTime(words[2]);
+      if (seconds < 0.0) continue;
+      if (words[1].toInt() == 0) pregapStart = seconds;
+      if (words[1].toInt() == 1) {
+        track.startSeconds = seconds;
+        if (!tracks.isEmpty() && tracks.last().filePath == currentFile && tracks.last().endSeconds < 0.0) {
+          tracks.last().endSeconds = (pregapStart >= 0.0 ? pregapStart : seconds);
+        }
+      }
+    } else if (command == "TITLE" && words.size() > 1) {
+      if (inAudioTrack) track.title = words[1]; else if (tracks.isEmpty() && track.number == 0) title = words[1];
+    } else if (command == "PERFORMER" && words.size() > 1) {
+      if (inAudioTrack) track.performer = words[1]; else if (tracks.isEmpty() && track.number == 0) performer = words[1];
+    }
+  }
+  if (inAudioTrack && track.startSeconds >= 0.0) tracks.push_back(track);
+}
+
+double CueSheet::parseTime(const QString& time) {
+  QStringList parts = time.split(':');
+  if (parts.size() != 3) return -1.0;
+  bool okM, okS, okF;
+  int minutes = parts[0].toInt(&okM);
+  int seconds = parts[1].toInt(&okS);
+  int frames = parts[2].toInt(&okF);
+  if (!okM || !okS || !okF || minutes < 0 || seconds < 0 || seconds > 59 || frames < 0 || frames >= CUE_FRAMES_PER_SECOND) return -1.0;
+  return minutes * 60.0 + seconds + (double) frames / CUE_FRAMES_PER_SECOND;
+}
+
+QStringList CueSheet::tokenise(const QString& line) {
+  QStringList words;
+  QString word;
+  bool quoted = false;
+  bool started = false;
+  for (int i = 0; i < line.size(); i++) {
+    QChar c = line[i];
+    if (c == '"') {
+      quoted = !quoted;
+      started = true;
+    } else if (c.isSpace() && !quoted) {
+      if (started) words << word;
+      word.clear();
+      started = false;
+    } else if (c != QChar(0xFEFF)) {
+      word += c;
+      started = true;
+    }
+  }
+  if (started) words << word;
+  return words;
+}
+
+QString CueSheet::resolveFile(const QString& name, const QDir& directory) {
+  QFileInfo info(directory, name);
+  if (info.exists()) return info.absoluteFilePath();
+  // rippers often leave the name of the WAV they wrote, but the image has
+  // since been compressed to something else; look for one by the same name
+  QStringList candidates = directory.entryList(QStringList() << QFileInfo(name).completeBaseName() + ".*", QDir::Files);
+  foreach (const QString& candidate, candidates) {
+    if (QFileInfo(candidate).suffix().toLower() != "cue") return directory.absoluteFilePath(candidate);
+  }
+  return info.absoluteFilePath(); // fails later with the decoder's error
+}
@@ -0,0 +1,76 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#ifndef CUESHEET_H
+#define CUESHEET_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTextCodec>
+#include <QDebug>
+
+/*
+
+A CUE sheet describes an album ripped to one image file (or a few) as a
+list of tracks, each starting at an index into its file. Only what's needed
+to analyse the tracks separately is kept: where each one starts and ends,
+and the titles and performers to show alongside.
+
+*/
+
+// CUE sheet times are minutes, seconds and CD frames
+const int CUE_FRAMES_PER_SECOND = 75;
+
+class CueTrack {
+public:
+  CueTrack() : number(0), startSeconds(0.0), endSeconds(-1.0) { }
+  int number;
+  QString title;
+  QString performer;
+  QString filePath;    // the audio file the track is in
+  double startSeconds; // INDEX 01
+  double endSeconds;   // the next track's start in the same file, or negative for the end of it
+};
+
+class CueSheet {
+public:
+  CueSheet(const QString& cuePath);
+  bool isValid() const; // false if unreadable or there are no audio tracks
+  QString getTitle() const;
+  QString getPerformer() const;
+  const QList<CueTrack>& getTracks() const;
+  // mm:ss:ff, or -1 if malformed
+  static double parseTime(const QString&);
+  // a command's words; quoted strings count as one
+  static QStringList tokenise(const QString&);
+private:
+  void parse(const QString& text, const QDir& directory);
+  static QString resolveFile(const QString& name, const QDir& directory);
+  QString title;
+  QString performer;
+  QList<CueTrack> tracks;
+};
+
+#endif // CUESHEET_H
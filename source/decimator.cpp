@@ -0,0 +1,100 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#include "decimator.h"
+
+Decimator::Decimator(unsigned int f, unsigned int frameRate, double cutoff) : factor(f), historyIndex(0), phase(0) {
+  if (factor < 1) factor = 1;
+  // windowed sinc; the transition band narrows as the factor increases
+  taps = tapsFor(factor);
+  coefficients.resize(taps);
+  double fc = cutoff / frameRate;
+  double pi = 4 * atan(1.0);
+  double sum = 0.0;
+  for (unsigned int i = 0; i < taps; i++) {
+    double n = (double) i - (taps - 1) / 2.0;
+    double sinc = (n == 0.0 ? 2.0 * fc : sin(2.0 * pi * fc * n) / (pi * n));
+    double blackman = 0.42 - 0.5 * cos(2.0 * pi * i / (taps - 1)) + 0.08 * cos(4.0 * pi * i / (taps - 1));
+    coefficients[i] = sinc * blackman;
+    sum += coefficients[i];
+  }
+  // unity gain at DC
+  for (unsigned int i = 0; i < taps; i++) {
+    coefficients[i] /= sum;
+  }
+  history.resize(taps * 2, 0.0);
+}
+
+unsigned int Decimator::getFactor() const {
+  return factor;
+}
+
+void Decimator::reset() {
+  std::fill(history.begin(), history.end(), 0.0);
+  historyIndex = 0;
+  phase = 0;
+}
+
+void Decimator::process(double sample, std::vector<double>& output) {
+  history[historyIndex] = sample;
+  history[historyIndex + taps] = sample;
+  historyIndex = (historyIndex + 1) % taps;
+  bool due = (phase == 0);
+  phase = (phase + 1) % factor;
+  if (!due) return;
+  // oldest sample is at historyIndex, newest at historyIndex + taps - 1
+  const double* window = &history[historyIndex];
+  double sum = 0.0;
+  for (unsigned int i = 0; i < taps; i++) {
+    sum += window[i] * coefficients[taps - 1 - i];
+  }
+  output.push_back(sum);
+}
+
+void Decimator::process(const double* samples, unsigned int count, std::vector<double>& output) {
+  for (unsigned int i = 0; i < count; i++) {
+    process(samples[i], output);
+  }
+}
+
+double Decimator::analysisCutoff() {
+  // matches the downsampling cutoff in KeyFinder::preprocess
+  return KeyFinder::getLastFrequency() * 1.10;
+}
+
+double Decimator::transitionWidth(unsigned int factor, unsigned int frameRate) {
+  // a Blackman window's transition band is about 5.5 bins wide
+  return 5.5 * frameRate / tapsFor(factor);
+}
+
+unsigned int Decimator::analysisFactor(unsigned int frameRate) {
+  // the largest factor that puts the whole transition band, not just the
+  // cutoff, below the output Nyquist, so nothing aliases into the bands
+  // KeyFinder analyses
+  unsigned int f = 1;
+  while (analysisCutoff() + transitionWidth(f + 1, frameRate) <= frameRate / 2.0 / (f + 1)) f++;
+  return f;
+}
+
+unsigned int Decimator::tapsFor(unsigned int factor) {
+  return factor * 64 + 1;
+}
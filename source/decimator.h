@@ -0,0 +1,61 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include <keyfinder/constants.h>
+
+/*
+
+Streaming anti-aliased decimation by an integer factor. The FIR is only
+evaluated at output instants, which is the polyphase form of the filter; its
+history persists between calls so packets can be fed in as they're decoded.
+
+*/
+
+class Decimator {
+public:
+  Decimator(unsigned int factor, unsigned int frameRate, double cutoff);
+  unsigned int getFactor() const;
+  void reset();
+  void process(double, std::vector<double>&);
+  void process(const double*, unsigned int, std::vector<double>&);
+  // the factor KeyFinder would choose for this frame rate
+  static unsigned int analysisFactor(unsigned int frameRate);
+  static double analysisCutoff();
+  static double transitionWidth(unsigned int factor, unsigned int frameRate);
+private:
+  static unsigned int tapsFor(unsigned int factor);
+  unsigned int factor;
+  unsigned int taps;
+  unsigned int historyIndex;
+  unsigned int phase;
+  std::vector<double> coefficients;
+  std::vector<double> history; // doubled so each window is contiguous
+};
+
+#endif // DECIMATOR_H
@@ -21,9 +21,31 @@
 
 #include "decoderlibav.h"
 
-QMutex codecMutex;
+const char* LIGHTWEIGHT_PROBE_SIZE = "65536";       // bytes
+const char* LIGHTWEIGHT_ANALYZE_DURATION = "500000"; // microseconds
 
-AudioFileDecoder::AudioFileDecoder(const QString& filePath, const int maxDuration) : filePathCh(NULL), frameBufferSize(((AVCODEC_MAX_AUDIO_FRAME_SIZE * 3) / 2) * sizeof(uint8_t)), audioStream(-1), badPacketCount(0), badPacketThreshold(100), codec(NULL), fCtx(NULL), cCtx(NULL), dict(NULL), rsCtx(NULL) {
+// libav serialises its own non-reentrant sections (codec open / close) via
+// this callback, so decoders can be set up and torn down concurrently
+int AudioFileDecoder::libavLockManager(void** mutex, enum AVLockOp op) {
+  switch (op) {
+  case AV_LOCK_CREATE:
+    *mutex = new QMutex();
+    return 0;
+  case AV_LOCK_OBTAIN:
+    static_cast<QMutex*>(*mutex)->lock();
+    return 0;
+  case AV_LOCK_RELEASE:
+    static_cast<QMutex*>(*mutex)->unlock();
+    return 0;
+  case AV_LOCK_DESTROY:
+    delete static_cast<QMutex*>(*mutex);
+    *mutex = NULL;
+    return 0;
+  }
+  return 1;
+}
+
+AudioFileDecoder::AudioFileDecoder(const QString& filePath, const int maxDuration, bool downmixAndDecimate) : filePathCh(NULL), audioStream(-1), badPacketCount(0), badPacketThreshold(100), codec(NULL), fCtx(NULL), cCtx(NULL), dict(NULL), localIO(NULL), frame(NULL), decimator(NULL), endOfStream(false) {
   // convert filepath
 #ifdef Q_OS_WIN
   const wchar_t* filePathWc = reinterpret_cast<const wchar_t*>(filePath.constData());
@@ -33,56 +55,70 @@ AudioFileDecoder::AudioFileDecoder(const QString& filePath, const int maxDuratio
   filePathCh = qstrdup(encodedPath.constData());
 #endif
 
-  frameBuffer = (uint8_t*)av_malloc(frameBufferSize);
-  frameBufferConverted = (uint8_t*)av_malloc(frameBufferSize);
-
-  QMutexLocker codecMutexLocker(&codecMutex); // mutex the libAV preparation
-
-  // open file
-  int openInputResult = avformat_open_input(&fCtx, filePathCh, NULL, NULL);
-  if (openInputResult != 0) {
-    qWarning("Could not open file %s (%d)", filePathCh, openInputResult);
-    free();
-    throw KeyFinder::Exception(GuiStrings::getInstance()->libavCouldNotOpenFile(openInputResult).toUtf8().constData());
+  // try a cheap open first: demuxer hinted by the file extension and a
+  // small probe budget. If that doesn't tell us enough, start again and let
+  // libav probe as much as it likes.
+  bool opened = false;
+  if (openInput(filePath, true) == 0) {
+    if (avformat_find_stream_info(fCtx, NULL) >= 0 && audioParametersKnown()) {
+      opened = true;
+    } else {
+      qDebug("Lightweight probe insufficient for %s, probing fully", filePathCh);
+      closeInput();
+    }
+  } else {
+    // a failed open has already freed the format context, but not our I/O
+    closeInput();
   }
 
-  if (avformat_find_stream_info(fCtx, NULL) < 0) {
-    qWarning("Could not find stream information for file %s", filePathCh);
-    free();
-    throw KeyFinder::Exception(GuiStrings::getInstance()->libavCouldNotFindStreamInformation().toUtf8().constData());
-  }
+  if (!opened) {
+    int openInputResult = openInput(filePath, false);
+    if (openInputResult != 0) {
+      qWarning("Could not open file %s (%d)", filePathCh, openInputResult);
+      free();
+      throw KeyFinder::Exception(GuiStrings::getInstance()->libavCouldNotOpenFile(openInputResult).toUtf8().constData());
+    }
 
-  for (int i=0; i<(signed)fCtx->nb_streams; i++) {
-    if (fCtx->streams[i]->codec->codec_type == AVMEDIA_TYPE_AUDIO) {
-      audioStream = i;
-      break;
+    if (avformat_find_stream_info(fCtx, NULL) < 0) {
+      qWarning("Could not find stream information for file %s", filePathCh);
+      free();
+      throw KeyFinder::Exception(GuiStrings::getInstance()->libavCouldNotFindStreamInformation().toUtf8().constData());
     }
   }
 
-  if (audioStream == -1) {
+  // libav's choice of audio stream, which weighs up default dispositions,
+  // channel counts and whether there's a decoder, rather than the first
+  int bestStream = av_find_best_stream(fCtx, AVMEDIA_TYPE_AUDIO, -1, -1, &codec, 0);
+  if (bestStream == AVERROR_DECODER_NOT_FOUND) {
+    qWarning("Audio stream has unsupported codec in file %s", filePathCh);
+    free();
+    throw KeyFinder::Exception(GuiStrings::getInstance()->libavUnsupportedCodec().toUtf8().constData());
+  }
+  if (bestStream < 0) {
     qWarning("Could not find an audio stream for file %s", filePathCh);
     free();
     throw KeyFinder::Exception(GuiStrings::getInstance()->libavCouldNotFindAudioStream().toUtf8().constData());
   }
+  audioStream = bestStream;
+
+  // the demuxer skips everything else (video, cover art, subtitles) rather
+  // than reading it into packets only for us to throw them away
+  for (int i=0; i<(signed)fCtx->nb_streams; i++) {
+    if (i != audioStream) fCtx->streams[i]->discard = AVDISCARD_ALL;
+  }
 
   // Determine duration
   int durationSeconds = fCtx->duration / AV_TIME_BASE;
   int durationMinutes = durationSeconds / 60;
-  // First condition is a hack for bizarre overestimation of some MP3s
-  if (durationMinutes < 720 && durationSeconds > maxDuration * 60) {
+  // Second condition is a hack for bizarre overestimation of some MP3s
+  if (maxDuration != NO_MAX_DURATION && durationMinutes < 720 && durationSeconds > maxDuration * 60) {
     qWarning("Duration of file %s (%d:%d) exceeds specified maximum (%d:00)", filePathCh, durationMinutes, durationSeconds % 60, maxDuration);
     free();
     throw KeyFinder::Exception(GuiStrings::getInstance()->durationExceedsPreference(durationMinutes, durationSeconds % 60, maxDuration).toUtf8().constData());
   }
 
-  // Determine stream codec
+  // Determine stream codec, already found along with the stream
   cCtx = fCtx->streams[audioStream]->codec;
-  codec = avcodec_find_decoder(cCtx->codec_id);
-  if (codec == NULL) {
-    qWarning("Audio stream has unsupported codec in file %s", filePathCh);
-    free();
-    throw KeyFinder::Exception(GuiStrings::getInstance()->libavUnsupportedCodec().toUtf8().constData());
-  }
 
   // Open codec
   int codecOpenResult = avcodec_open2(cCtx, codec, &dict);
@@ -92,50 +128,173 @@ AudioFileDecoder::AudioFileDecoder(const QString& filePath, const int maxDuratio
     throw KeyFinder::Exception(GuiStrings::getInstance()->libavCouldNotOpenCodec(codec->long_name, codecOpenResult).toUtf8().constData());
   }
 
-  rsCtx = av_audio_resample_init(cCtx->channels, cCtx->channels, cCtx->sample_rate, cCtx->sample_rate, AV_SAMPLE_FMT_S16, cCtx->sample_fmt, 0, 0, 0, 0);
-  if (rsCtx == NULL) {
-    qWarning("Could not create ReSampleContext for file %s", filePathCh);
+  // samples are converted from the codec's native format as they're decoded
+  if (!SampleConversion::formatSupported((AVSampleFormat) cCtx->sample_fmt)) {
+    qWarning("Unsupported sample format %s in file %s", av_get_sample_fmt_name(cCtx->sample_fmt), filePathCh);
     free();
-    throw KeyFinder::Exception(GuiStrings::getInstance()->libavCouldNotCreateResampleContext().toUtf8().constData());
+    throw KeyFinder::Exception(GuiStrings::getInstance()->libavUnsupportedSampleFormat(av_get_sample_fmt_name(cCtx->sample_fmt)).toUtf8().constData());
+  }
+
+  frame = av_frame_alloc();
+
+  // mono output at (roughly) the rate the chromagram is computed at, so
+  // KeyFinder's own downsampling becomes a no-op
+  if (downmixAndDecimate) {
+    decimator = new Decimator(Decimator::analysisFactor(cCtx->sample_rate), cCtx->sample_rate, Decimator::analysisCutoff());
   }
 
   qDebug("Decoder prepared for %s (%s, %d)", filePathCh, av_get_sample_fmt_name(cCtx->sample_fmt), cCtx->sample_rate);
 }
 
+int AudioFileDecoder::openInput(const QString& filePath, bool lightweight) {
+  // through our own I/O where possible
+  localIO = new LocalFileIO(filePath);
+  if (localIO->isOpen()) {
+    fCtx = avformat_alloc_context();
+    fCtx->pb = localIO->getContext();
+  } else {
+    delete localIO;
+    localIO = NULL;
+  }
+  AVInputFormat* format = NULL;
+  AVDictionary* options = NULL;
+  if (lightweight) {
+    format = formatForExtension(QFileInfo(filePath).suffix().toLower());
+    av_dict_set(&options, "probesize", LIGHTWEIGHT_PROBE_SIZE, 0);
+    av_dict_set(&options, "analyzeduration", LIGHTWEIGHT_ANALYZE_DURATION, 0);
+  }
+  int result = avformat_open_input(&fCtx, filePathCh, format, &options);
+  av_dict_free(&options);
+  return result;
+}
+
+void AudioFileDecoder::closeInput() {
+  if (fCtx != NULL) avformat_close_input(&fCtx);
+  delete localIO; // after the format context, which reads through it
+  localIO = NULL;
+}
+
+bool AudioFileDecoder::audioParametersKnown() const {
+  for (int i=0; i<(signed)fCtx->nb_streams; i++) {
+    AVCodecContext* ctx = fCtx->streams[i]->codec;
+    if (ctx->codec_type == AVMEDIA_TYPE_AUDIO && ctx->sample_rate > 0 && ctx->channels > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+AVInputFormat* AudioFileDecoder::formatForExtension(const QString& extension) {
+  const char* name = NULL;
+  if (extension == "mp3") {
+    name = "mp3";
+  } else if (extension == "m4a" || extension == "mp4") {
+    name = "mov";
+  } else if (extension == "aac") {
+    name = "aac";
+  } else if (extension == "flac") {
+    name = "flac";
+  } else if (extension == "wav") {
+    name = "wav";
+  } else if (extension == "aif" || extension == "aiff") {
+    name = "aiff";
+  } else if (extension == "wma") {
+    name = "asf";
+  } else if (extension == "ogg") {
+    name = "ogg";
+  }
+  return (name == NULL ? NULL : av_find_input_format(name));
+}
+
 void AudioFileDecoder::free() {
-  av_free(frameBuffer);
-  av_free(frameBufferConverted);
-  if (rsCtx != NULL) audio_resample_close(rsCtx);
+  delete decimator;
+  if (frame != NULL) av_frame_free(&frame);
   if (cCtx != NULL) {
     int codecCloseResult = avcodec_close(cCtx);
     if (codecCloseResult < 0) {
       qCritical("Error closing audio codec: %s (%d)", codec->long_name, codecCloseResult);
     }
   }
-  if (fCtx != NULL) av_close_input_file(fCtx);
+  closeInput();
   if (filePathCh != NULL) delete[] filePathCh;
 }
 
 AudioFileDecoder::~AudioFileDecoder() {
-  QMutexLocker codecMutexLocker(&codecMutex);
   free();
 }
 
-KeyFinder::AudioData* AudioFileDecoder::decodeNextAudioPacket() {
-  // Prep buffer
-  KeyFinder::AudioData* audio = NULL;
+unsigned int AudioFileDecoder::getFrameRate() const {
+  if (decimator != NULL) return (unsigned int) cCtx->sample_rate / decimator->getFactor();
+  return (unsigned int) cCtx->sample_rate;
+}
+
+unsigned int AudioFileDecoder::getChannels() const {
+  if (decimator != NULL) return 1;
+  return (unsigned int) cCtx->channels;
+}
+
+double AudioFileDecoder::getDurationSeconds() const {
+  if (fCtx->duration == (int64_t) AV_NOPTS_VALUE || fCtx->duration <= 0) return 0.0;
+  return fCtx->duration / (double) AV_TIME_BASE;
+}
+
+bool AudioFileDecoder::seekToSeconds(double seconds) {
+  if (seconds < 0.0) seconds = 0.0;
+  AVStream* stream = fCtx->streams[audioStream];
+  int64_t size = (fCtx->pb != NULL ? avio_size(fCtx->pb) : -1);
+  double duration = getDurationSeconds();
+  // a proportional byte offset is good enough (and cheap) for MP3s without an
+  // index, and the fallback for anything else that can't seek by time
+  bool canByteSeek = size > 0 && duration > 0.0 && !(fCtx->iformat->flags & AVFMT_NO_BYTE_SEEK);
+  int result = -1;
+  if (canByteSeek && cCtx->codec_id == AV_CODEC_ID_MP3 && stream->nb_index_entries == 0) {
+    result = av_seek_frame(fCtx, audioStream, (int64_t) (size * seconds / duration), AVSEEK_FLAG_BYTE);
+  }
+  if (result < 0) {
+    int64_t timestamp = (int64_t) (seconds * stream->time_base.den / stream->time_base.num);
+    if (stream->start_time != (int64_t) AV_NOPTS_VALUE) timestamp += stream->start_time;
+    result = av_seek_frame(fCtx, audioStream, timestamp, AVSEEK_FLAG_BACKWARD);
+  }
+  if (result < 0 && canByteSeek) {
+    result = av_seek_frame(fCtx, audioStream, (int64_t) (size * seconds / duration), AVSEEK_FLAG_BYTE);
+  }
+  if (result < 0) {
+    qWarning("Could not seek to %f seconds in file %s (%d)", seconds, filePathCh, result);
+    return false;
+  }
+  avcodec_flush_buffers(cCtx);
+  decodedSamples.clear();
+  if (decimator != NULL) decimator->reset();
+  endOfStream = false;
+  return true;
+}
+
+bool AudioFileDecoder::decodeNextAudioChunk(KeyFinder::AudioData& chunk, unsigned int chunkFrames) {
+  unsigned int chunkSamples = chunkFrames * getChannels();
+  // decode whole packets until there's enough for a chunk; any excess is
+  // carried over to the next call
+  while (decodedSamples.size() < chunkSamples && !endOfStream) {
+    if (!decodeNextAudioPacket()) endOfStream = true;
+  }
+  unsigned int sampleCount = std::min(chunkSamples, (unsigned int) decodedSamples.size());
+  sampleCount -= sampleCount % getChannels(); // whole frames only
+  if (sampleCount == 0) return false;
+  fillChunk(chunk, &decodedSamples[0], sampleCount);
+  decodedSamples.erase(decodedSamples.begin(), decodedSamples.begin() + sampleCount);
+  return true;
+}
+
+bool AudioFileDecoder::decodeNextAudioPacket() {
   // Decode stream
   AVPacket avpkt;
   do {
     av_init_packet(&avpkt);
-    if (av_read_frame(fCtx, &avpkt) < 0) return audio;
+    if (av_read_frame(fCtx, &avpkt) < 0) return false;
+    // other streams are discarded at open, but not every demuxer honours it
     if (avpkt.stream_index != audioStream) av_free_packet(&avpkt);
   } while (avpkt.data == NULL);
   try {
-    audio = new KeyFinder::AudioData();
-    audio->setFrameRate((unsigned int) cCtx->sample_rate);
-    audio->setChannels(cCtx->channels);
-    if (!decodePacket(&avpkt, audio)) {
+    if (!decodePacket(&avpkt, decodedSamples)) {
       badPacketCount++;
       if (badPacketCount > badPacketThreshold) {
         av_free_packet(&avpkt);
@@ -149,42 +308,41 @@ KeyFinder::AudioData* AudioFileDecoder::decodeNextAudioPacket() {
     throw e;
   }
   av_free_packet(&avpkt);
-  return audio;
+  return true;
 }
 
-bool AudioFileDecoder::decodePacket(AVPacket* originalPacket, KeyFinder::AudioData* audio) {
+bool AudioFileDecoder::decodePacket(AVPacket* originalPacket, std::vector<double>& output) {
   // copy packet so we can shift data pointer about without endangering garbage collection
   AVPacket tempPacket;
+  av_init_packet(&tempPacket);
   tempPacket.size = originalPacket->size;
   tempPacket.data = originalPacket->data;
   // loop in case audio packet contains multiple frames
   while (tempPacket.size > 0) {
-    int dataSize = frameBufferSize;
-    int16_t* dataBuffer = (int16_t*)frameBuffer;
-    int bytesConsumed = avcodec_decode_audio3(cCtx, dataBuffer, &dataSize, &tempPacket);
+    int gotFrame = 0;
+    int bytesConsumed = avcodec_decode_audio4(cCtx, frame, &gotFrame, &tempPacket);
     if (bytesConsumed < 0) { // error
       tempPacket.size = 0;
       return false;
     }
     tempPacket.data += bytesConsumed;
     tempPacket.size -= bytesConsumed;
-    if (dataSize <= 0) continue; // nothing decoded
-    int newSamplesDecoded = dataSize / av_get_bytes_per_sample(cCtx->sample_fmt);
-    // Resample if necessary
-    if (cCtx->sample_fmt != AV_SAMPLE_FMT_S16) {
-      int resampleResult = audio_resample(rsCtx, (short*)frameBufferConverted, (short*)frameBuffer, newSamplesDecoded);
-      if (resampleResult < 0) {
-        throw KeyFinder::Exception(GuiStrings::getInstance()->libavCouldNotResample().toUtf8().constData());
-      }
-      dataBuffer = (int16_t*)frameBufferConverted;
+    if (!gotFrame || frame->nb_samples <= 0) continue; // nothing decoded
+    // straight to output, unless it's to be downmixed and decimated first;
+    // the buffers keep their capacity between packets so this rarely allocates
+    AVSampleFormat format = (AVSampleFormat) frame->format;
+    sample_kernel_t kernel = (decimator != NULL ? SampleConversion::downmixKernel(format, cCtx->channels) : SampleConversion::interleavedKernel(format, cCtx->channels));
+    if (kernel == NULL) {
+      throw KeyFinder::Exception(GuiStrings::getInstance()->libavUnsupportedSampleFormat(av_get_sample_fmt_name(format)).toUtf8().constData());
     }
-    int oldSampleCount = audio->getSampleCount();
-    audio->addToSampleCount(newSamplesDecoded);
-    audio->resetIterators();
-    audio->advanceWriteIterator(oldSampleCount);
-    for (int i = 0; i < newSamplesDecoded; i++) {
-      audio->setSampleAtWriteIterator(static_cast<double>(dataBuffer[i]));
-      audio->advanceWriteIterator();
+    if (decimator != NULL) {
+      converted.resize(frame->nb_samples);
+      kernel(frame->extended_data, cCtx->channels, frame->nb_samples, &converted[0]);
+      decimator->process(&converted[0], frame->nb_samples, output);
+    } else {
+      size_t offset = output.size();
+      output.resize(offset + frame->nb_samples * cCtx->channels);
+      kernel(frame->extended_data, cCtx->channels, frame->nb_samples, &output[offset]);
     }
   }
   return true;
@@ -23,15 +23,22 @@
 #define LIBAVDECODER_H
 
 #include <iomanip>
+#include <vector>
+#include <algorithm>
 
 #include <QString>
 #include <QMutex>
 #include <QFile>
+#include <QFileInfo>
 
 #include "keyfinder/exception.h"
 #include "keyfinder/audiodata.h"
 
+#include "audiodecoder.h"
 #include "strings.h"
+#include "decimator.h"
+#include "sampleconversion.h"
+#include "localfileio.h"
 
 #ifndef INT64_C
 #define UINT64_C(c) (c ## ULL)
@@ -41,6 +48,8 @@
 #define AUDIO_REFILL_THRESH 4096
 extern "C"{
 #include <libavutil/avutil.h>
+#include <libavutil/frame.h>
+#include <libavutil/samplefmt.h>
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 }
@@ -49,17 +58,24 @@ extern "C"{
 #include "os_windows.h"
 #endif
 
-class AudioFileDecoder {
+class AudioFileDecoder : public AudioDecoder {
 public:
-  AudioFileDecoder(const QString&, const int);
-  ~AudioFileDecoder();
-  KeyFinder::AudioData* decodeNextAudioPacket();
+  AudioFileDecoder(const QString&, const int, bool downmixAndDecimate = false);
+  virtual ~AudioFileDecoder();
+  virtual bool decodeNextAudioChunk(KeyFinder::AudioData&, unsigned int);
+  virtual unsigned int getFrameRate() const;
+  virtual unsigned int getChannels() const;
+  virtual double getDurationSeconds() const;
+  virtual bool seekToSeconds(double);
+  static int libavLockManager(void**, enum AVLockOp);
 private:
   void free();
+  int openInput(const QString&, bool);
+  void closeInput();
+  bool audioParametersKnown() const;
+  static AVInputFormat* formatForExtension(const QString&);
+  bool decodeNextAudioPacket();
   char* filePathCh;
-  uint8_t* frameBuffer;
-  uint8_t* frameBufferConverted;
-  int frameBufferSize;
   int audioStream;
   int badPacketCount;
   int badPacketThreshold;
@@ -67,8 +83,13 @@ private:
   AVFormatContext* fCtx;
   AVCodecContext* cCtx;
   AVDictionary* dict; // stays NULL, just here for legibility
-  ReSampleContext* rsCtx;
-  bool decodePacket(AVPacket*, KeyFinder::AudioData*);
+  LocalFileIO* localIO; // NULL if libav is doing its own I/O
+  AVFrame* frame;
+  Decimator* decimator; // NULL unless downmixing to the analysis rate
+  bool endOfStream;
+  std::vector<double> decodedSamples; // decoded but not yet handed out
+  std::vector<double> converted; // scratch for the downmix
+  bool decodePacket(AVPacket*, std::vector<double>&);
 };
 
 #endif
@@ -0,0 +1,347 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#include "decoderpcm.h"
+
+#include <math.h>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+// input frames converted per pass when decimating
+const unsigned int DECIMATION_BLOCK_FRAMES = 65536;
+const qint64 RELEASE_THRESHOLD_BYTES = 8 * 1024 * 1024;
+
+// AIFF stores its sample rate as an 80-bit extended float
+static unsigned int extendedToUnsigned(const uchar* bytes) {
+  if (bytes[0] & 0x80) return 0;
+  int exponent = (((bytes[0] & 0x7F) << 8) | bytes[1]) - 16383 - 63;
+  quint64 mantissa = qFromBigEndian<quint64>(bytes + 2);
+  return (unsigned int) (ldexp((double) mantissa, exponent) + 0.5);
+}
+
+// integer samples of any width to left-justified 32-bit
+template <unsigned int BYTES, bool BE>
+static void unpackIntegers(const uchar* in, size_t samples, int32_t* out) {
+  for (size_t i = 0; i < samples; i++, in += BYTES) {
+    quint32 value = 0;
+    for (unsigned int b = 0; b < BYTES; b++) {
+      value = (value << 8) | in[BE ? b : BYTES - 1 - b];
+    }
+    out[i] = (int32_t) (value << (32 - 8 * BYTES));
+  }
+}
+
+template <typename T, bool BE>
+static void swapFloats(const uchar* in, size_t samples, T* out) {
+  for (size_t i = 0; i < samples; i++, in += sizeof(T)) {
+    out[i] = (BE ? qFromBigEndian<T>(in) : qFromLittleEndian<T>(in));
+  }
+}
+
+PcmFileDecoder::PcmFileDecoder(const QString& filePath, const int maxDuration, bool downmixAndDecimate) : file(filePath), map(NULL), frameRate(0), channels(0), bytesPerSample(0), floatingPoint(false), bigEndian(false), unsignedBytes(false), dataOffset(0), frameCount(0), position(0), released(0), format(AV_SAMPLE_FMT_NONE), nativeLayout(false), decimator(NULL) {
+  if (!file.open(QIODevice::ReadOnly)) return;
+
+  QByteArray header = file.read(12);
+  bool parsed = false;
+  if (header.size() == 12 && header.startsWith("RIFF") && header.mid(8, 4) == "WAVE") {
+    parsed = parseWave();
+  } else if (header.size() == 12 && header.startsWith("FORM") && (header.mid(8, 4) == "AIFF" || header.mid(8, 4) == "AIFC")) {
+    parsed = parseAiff(header.mid(8, 4) == "AIFC");
+  }
+  if (!parsed || frameCount <= 0 || !chooseFormat()) {
+    file.close();
+    return;
+  }
+
+  int durationSeconds = (int) (frameCount / frameRate);
+  if (maxDuration != NO_MAX_DURATION && durationSeconds > maxDuration * 60) {
+    qWarning("Duration of file %s (%d:%d) exceeds specified maximum (%d:00)", qPrintable(filePath), durationSeconds / 60, durationSeconds % 60, maxDuration);
+    file.close();
+    throw KeyFinder::Exception(GuiStrings::getInstance()->durationExceedsPreference(durationSeconds / 60, durationSeconds % 60, maxDuration).toUtf8().constData());
+  }
+
+  // just the samples; headers and any trailing metadata stay on disk
+  qint64 dataSize = frameCount * channels * bytesPerSample;
+  map = file.map(dataOffset, dataSize);
+  if (map == NULL) {
+    file.close();
+    return;
+  }
+  adviseSequential(dataSize);
+
+  if (downmixAndDecimate) {
+    decimator = new Decimator(Decimator::analysisFactor(frameRate), frameRate, Decimator::analysisCutoff());
+  }
+
+  qDebug("PCM decoder prepared for %s (%d bytes per sample, %d)", qPrintable(filePath), bytesPerSample, frameRate);
+}
+
+PcmFileDecoder::~PcmFileDecoder() {
+  delete decimator;
+  if (map != NULL) file.unmap(map);
+  file.close();
+}
+
+bool PcmFileDecoder::isOpen() const {
+  return map != NULL;
+}
+
+bool PcmFileDecoder::readChunkHeader(QByteArray& id, quint32& size, bool bigEndianSize) {
+  QByteArray chunkHeader = file.read(8);
+  if (chunkHeader.size() < 8) return false;
+  id = chunkHeader.left(4);
+  const uchar* sizeBytes = reinterpret_cast<const uchar*>(chunkHeader.constData()) + 4;
+  size = (bigEndianSize ? qFromBigEndian<quint32>(sizeBytes) : qFromLittleEndian<quint32>(sizeBytes));
+  return true;
+}
+
+bool PcmFileDecoder::parseWave() {
+  bool haveFormat = false;
+  QByteArray id;
+  quint32 size;
+  while (readChunkHeader(id, size, false)) {
+    qint64 chunkStart = file.pos();
+    if (id == "fmt ") {
+      QByteArray fmt = file.read(qMin(size, (quint32) 40));
+      if (fmt.size() < 16) return false;
+      const uchar* f = reinterpret_cast<const uchar*>(fmt.constData());
+      quint16 tag = qFromLittleEndian<quint16>(f);
+      channels = qFromLittleEndian<quint16>(f + 2);
+      frameRate = qFromLittleEndian<quint32>(f + 4);
+      quint16 blockAlign = qFromLittleEndian<quint16>(f + 12);
+      quint16 bits = qFromLittleEndian<quint16>(f + 14);
+      if (tag == 0xFFFE) { // WAVE_FORMAT_EXTENSIBLE; the real tag leads the sub-format GUID
+        if (fmt.size() < 26) return false;
+        tag = qFromLittleEndian<quint16>(f + 24);
+      }
+      if (tag != 1 && tag != 3) return false; // integer and float PCM only
+      if (channels == 0 || bits == 0 || blockAlign % channels != 0) return false;
+      bytesPerSample = blockAlign / channels;
+      if ((bits + 7u) / 8 != bytesPerSample) return false; // padded containers
+      floatingPoint = (tag == 3);
+      unsignedBytes = (bytesPerSample == 1);
+      bigEndian = false;
+      haveFormat = true;
+    } else if (id == "data") {
+      if (!haveFormat) return false;
+      dataOffset = chunkStart;
+      // streaming writers sometimes leave the size unset
+      qint64 available = file.size() - dataOffset;
+      qint64 dataSize = (size == 0 || size == 0xFFFFFFFF ? available : qMin((qint64) size, available));
+      frameCount = dataSize / (channels * bytesPerSample);
+      return true;
+    }
+    if (!file.seek(chunkStart + size + (size & 1))) return false;
+  }
+  return false;
+}
+
+bool PcmFileDecoder::parseAiff(bool compressed) {
+  bool haveFormat = false;
+  quint32 commFrames = 0;
+  qint64 soundStart = -1;
+  quint32 soundSize = 0;
+  QByteArray id;
+  quint32 size;
+  while ((!haveFormat || soundStart < 0) && readChunkHeader(id, size, true)) {
+    qint64 chunkStart = file.pos();
+    if (id == "COMM") {
+      QByteArray comm = file.read(qMin(size, (quint32) 22));
+      if (comm.size() < 18) return false;
+      const uchar* c = reinterpret_cast<const uchar*>(comm.constData());
+      channels = qFromBigEndian<quint16>(c);
+      commFrames = qFromBigEndian<quint32>(c + 2);
+      quint16 bits = qFromBigEndian<quint16>(c + 6);
+      frameRate = extendedToUnsigned(c + 8);
+      floatingPoint = false;
+      bigEndian = true;
+      if (compressed) {
+        if (comm.size() < 22) return false;
+        QByteArray type = comm.mid(18, 4);
+        if (type == "sowt") {
+          bigEndian = false;
+        } else if (type == "fl32" || type == "FL32") {
+          floatingPoint = true;
+          bits = 32;
+        } else if (type == "fl64" || type == "FL64") {
+          floatingPoint = true;
+          bits = 64;
+        } else if (type != "NONE" && type != "twos") {
+          return false;
+        }
+      }
+      if (channels == 0 || bits == 0) return false;
+      bytesPerSample = (bits + 7u) / 8;
+      unsignedBytes = false;
+      haveFormat = true;
+    } else if (id == "SSND") {
+      soundStart = chunkStart;
+      soundSize = size;
+    }
+    if (!file.seek(chunkStart + size + (size & 1))) break;
+  }
+  if (!haveFormat || soundStart < 0 || soundSize < 8) return false;
+  if (!file.seek(soundStart)) return false;
+  QByteArray ssnd = file.read(8);
+  if (ssnd.size() < 8) return false;
+  quint32 offset = qFromBigEndian<quint32>(reinterpret_cast<const uchar*>(ssnd.constData()));
+  dataOffset = soundStart + 8 + offset;
+  qint64 available = qMin(file.size(), soundStart + soundSize) - dataOffset;
+  if (available <= 0) return false;
+  frameCount = qMin((qint64) commFrames, available / (channels * bytesPerSample));
+  return true;
+}
+
+bool PcmFileDecoder::chooseFormat() {
+  bool hostBigEndian = (Q_BYTE_ORDER == Q_BIG_ENDIAN);
+  if (frameRate == 0) return false;
+  // the mapping starts at the same offset within a page as the data does,
+  // and the kernels read whole samples, so the data can only be read in
+  // place if it starts on a sample boundary. An 18-byte fmt chunk or an
+  // SSND offset can leave it anywhere.
+  bool aligned = (dataOffset % bytesPerSample == 0);
+  if (floatingPoint) {
+    if (bytesPerSample != 4 && bytesPerSample != 8) return false;
+    format = (bytesPerSample == 4 ? AV_SAMPLE_FMT_FLT : AV_SAMPLE_FMT_DBL);
+    nativeLayout = (bigEndian == hostBigEndian && aligned);
+  } else if (bytesPerSample == 1 && unsignedBytes) {
+    format = AV_SAMPLE_FMT_U8;
+    nativeLayout = true;
+  } else if (bytesPerSample <= 4) {
+    // anything else integer is widened to 32 bits unless it's already native
+    nativeLayout = (bigEndian == hostBigEndian && aligned && (bytesPerSample == 2 || bytesPerSample == 4));
+    format = (nativeLayout && bytesPerSample == 2 ? AV_SAMPLE_FMT_S16 : AV_SAMPLE_FMT_S32);
+  } else {
+    return false;
+  }
+  return SampleConversion::interleavedKernel(format, channels) != NULL;
+}
+
+void PcmFileDecoder::adviseSequential(qint64 dataSize) {
+#if defined(Q_OS_LINUX)
+  posix_fadvise(file.handle(), dataOffset, dataSize, POSIX_FADV_SEQUENTIAL);
+#elif defined(Q_OS_MAC)
+  fcntl(file.handle(), F_RDAHEAD, 1);
+#endif
+#ifdef Q_OS_UNIX
+  // the mapping starts wherever the data chunk does; madvise wants a page
+  quintptr page = (quintptr) sysconf(_SC_PAGESIZE);
+  quintptr start = (quintptr) map & ~(page - 1);
+  madvise((void*) start, (quintptr) map + dataSize - start, MADV_SEQUENTIAL);
+#endif
+}
+
+const uint8_t* PcmFileDecoder::samplesAt(qint64 frame, unsigned int frames) {
+  const uchar* in = map + frame * channels * bytesPerSample;
+  if (nativeLayout) return in;
+  size_t samples = (size_t) frames * channels;
+  normalised.resize(samples * av_get_bytes_per_sample(format));
+  if (format == AV_SAMPLE_FMT_FLT) {
+    float* out = reinterpret_cast<float*>(&normalised[0]);
+    if (bigEndian) swapFloats<float, true>(in, samples, out);
+    else swapFloats<float, false>(in, samples, out);
+  } else if (format == AV_SAMPLE_FMT_DBL) {
+    double* out = reinterpret_cast<double*>(&normalised[0]);
+    if (bigEndian) swapFloats<double, true>(in, samples, out);
+    else swapFloats<double, false>(in, samples, out);
+  } else {
+    int32_t* out = reinterpret_cast<int32_t*>(&normalised[0]);
+    int layout = (int) bytesPerSample * (bigEndian ? -1 : 1);
+    switch (layout) {
+    case  1: unpackIntegers<1, false>(in, samples, out); break;
+    case -1: unpackIntegers<1, true>(in, samples, out); break;
+    case  2: unpackIntegers<2, false>(in, samples, out); break;
+    case -2: unpackIntegers<2, true>(in, samples, out); break;
+    case  3: unpackIntegers<3, false>(in, samples, out); break;
+    case -3: unpackIntegers<3, true>(in, samples, out); break;
+    case  4: unpackIntegers<4, false>(in, samples, out); break;
+    case -4: unpackIntegers<4, true>(in, samples, out); break;
+    }
+  }
+  return &normalised[0];
+}
+
+void PcmFileDecoder::releaseConsumed() {
+  // what's been converted isn't needed again (barring a seek, which just
+  // faults it back in), so it needn't count against the process
+  qint64 frameBytes = channels * bytesPerSample;
+  if ((position - released) * frameBytes < RELEASE_THRESHOLD_BYTES) return;
+  LocalFileIO::releaseMapped(map + released * frameBytes, map + position * frameBytes);
+  released = position;
+}
+
+unsigned int PcmFileDecoder::getFrameRate() const {
+  if (decimator != NULL) return frameRate / decimator->getFactor();
+  return frameRate;
+}
+
+unsigned int PcmFileDecoder::getChannels() const {
+  if (decimator != NULL) return 1;
+  return channels;
+}
+
+double PcmFileDecoder::getDurationSeconds() const {
+  return frameCount / (double) frameRate;
+}
+
+bool PcmFileDecoder::seekToSeconds(double seconds) {
+  if (seconds < 0.0) seconds = 0.0;
+  position = std::min(frameCount, (qint64) (seconds * frameRate));
+  decodedSamples.clear();
+  if (decimator != NULL) decimator->reset();
+  return true;
+}
+
+bool PcmFileDecoder::decodeNextAudioChunk(KeyFinder::AudioData& chunk, unsigned int chunkFrames) {
+  if (decimator == NULL) {
+    // straight from the mapping into the chunk, via one conversion pass
+    unsigned int frames = (unsigned int) std::min((qint64) chunkFrames, frameCount - position);
+    if (frames == 0) return false;
+    const uint8_t* planes[1] = { samplesAt(position, frames) };
+    converted.resize((size_t) frames * channels);
+    SampleConversion::interleavedKernel(format, channels)(planes, channels, frames, &converted[0]);
+    position += frames;
+    releaseConsumed();
+    fillChunk(chunk, &converted[0], frames * channels);
+    return true;
+  }
+  // downmix and decimate a block at a time until there's enough for a chunk
+  sample_kernel_t kernel = SampleConversion::downmixKernel(format, channels);
+  while (decodedSamples.size() < chunkFrames && position < frameCount) {
+    unsigned int frames = (unsigned int) std::min((qint64) DECIMATION_BLOCK_FRAMES, frameCount - position);
+    const uint8_t* planes[1] = { samplesAt(position, frames) };
+    converted.resize(frames);
+    kernel(planes, channels, frames, &converted[0]);
+    decimator->process(&converted[0], frames, decodedSamples);
+    position += frames;
+    releaseConsumed();
+  }
+  unsigned int sampleCount = std::min(chunkFrames, (unsigned int) decodedSamples.size());
+  if (sampleCount == 0) return false;
+  fillChunk(chunk, &decodedSamples[0], sampleCount);
+  decodedSamples.erase(decodedSamples.begin(), decodedSamples.begin() + sampleCount);
+  return true;
+}
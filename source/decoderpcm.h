@@ -0,0 +1,90 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#ifndef DECODERPCM_H
+#define DECODERPCM_H
+
+#include <vector>
+#include <algorithm>
+
+#include <QFile>
+#include <QString>
+#include <QtEndian>
+
+#include "keyfinder/exception.h"
+
+#include "audiodecoder.h"
+#include "strings.h"
+#include "decimator.h"
+#include "sampleconversion.h"
+#include "localfileio.h"
+
+/*
+
+Reads uncompressed PCM from WAV and AIFF files without going near libav. The
+data chunk is memory-mapped and converted straight from the mapping, so no
+packets, frames or codec contexts are involved. Layouts that aren't already
+in a native sample format (24-bit, big-endian) take one extra pass through a
+scratch buffer first. Anything this doesn't recognise leaves it closed, and
+the caller should fall back to AudioFileDecoder.
+
+*/
+
+class PcmFileDecoder : public AudioDecoder {
+public:
+  PcmFileDecoder(const QString&, const int, bool downmixAndDecimate = false);
+  virtual ~PcmFileDecoder();
+  bool isOpen() const;
+  virtual bool decodeNextAudioChunk(KeyFinder::AudioData&, unsigned int);
+  virtual unsigned int getFrameRate() const;
+  virtual unsigned int getChannels() const;
+  virtual double getDurationSeconds() const;
+  virtual bool seekToSeconds(double);
+private:
+  QFile file;
+  uchar* map;
+  unsigned int frameRate;
+  unsigned int channels;
+  unsigned int bytesPerSample;
+  bool floatingPoint;
+  bool bigEndian;
+  bool unsignedBytes;
+  qint64 dataOffset;
+  qint64 frameCount;
+  qint64 position; // in frames
+  qint64 released; // mapped frames before this have been dropped
+  AVSampleFormat format; // what the kernels see
+  bool nativeLayout; // whether the mapping can go to the kernels as it is
+  Decimator* decimator; // NULL unless downmixing to the analysis rate
+  std::vector<uint8_t> normalised; // scratch for non-native layouts
+  std::vector<double> converted;
+  std::vector<double> decodedSamples; // decimated but not yet handed out
+  bool readChunkHeader(QByteArray&, quint32&, bool);
+  bool parseWave();
+  bool parseAiff(bool);
+  bool chooseFormat();
+  void adviseSequential(qint64);
+  const uint8_t* samplesAt(qint64, unsigned int);
+  void releaseConsumed();
+};
+
+#endif // DECODERPCM_H
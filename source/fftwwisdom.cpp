@@ -0,0 +1,96 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#include "fftwwisdom.h"
+
+#include <stdlib.h>
+
+// the frame size KeyFinder::preprocess asks its low-pass filter factory for
+static const unsigned int LOWPASS_FFT_FRAME_SIZE = 2048;
+
+QMutex FftwWisdom::plannerMutex;
+QFuture<void> FftwWisdom::warmUpFuture;
+
+QString FftwWisdom::cachePath() {
+  QString dir = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation);
+  return dir + "/" + QCoreApplication::organizationName() + "/fftw.wisdom";
+}
+
+bool FftwWisdom::load(const QString& path) {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return false;
+  QByteArray wisdom = file.readAll();
+  QMutexLocker locker(&plannerMutex);
+  if (fftw_import_wisdom_from_string(wisdom.constData()) == 0) {
+    qWarning("Ignoring unreadable FFTW wisdom in %s", path.toUtf8().constData());
+    return false;
+  }
+  return true;
+}
+
+bool FftwWisdom::save(const QString& path) {
+  // libkeyfinder may still be planning for a batch that outlived its window
+  QThreadPool::globalInstance()->waitForDone();
+  QByteArray wisdom;
+  {
+    QMutexLocker locker(&plannerMutex);
+    char* exported = fftw_export_wisdom_to_string();
+    if (exported == NULL) return false;
+    wisdom = QByteArray(exported);
+    free(exported);
+  }
+  // written whole and renamed into place, so concurrent CLI runs can't
+  // leave a half-written file behind
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  QSaveFile file(path);
+  if (!file.open(QIODevice::WriteOnly)) return false;
+  file.write(wisdom);
+  return file.commit();
+}
+
+void FftwWisdom::warmUp() {
+  // the plans libkeyfinder's adapters make, and with its flags: the
+  // chromagram's real to complex transform, and the complex inverse the
+  // low-pass filter is designed with
+  QMutexLocker locker(&plannerMutex);
+  unsigned int n = KeyFinder::FFTFRAMESIZE;
+  double* input = (double*) fftw_malloc(sizeof(double) * n);
+  fftw_complex* output = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * n);
+  fftw_destroy_plan(fftw_plan_dft_r2c_1d(n, input, output, FFTW_ESTIMATE));
+  fftw_free(input);
+  fftw_free(output);
+
+  n = LOWPASS_FFT_FRAME_SIZE;
+  fftw_complex* inverseInput = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * n);
+  fftw_complex* inverseOutput = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * n);
+  fftw_destroy_plan(fftw_plan_dft_1d(n, inverseInput, inverseOutput, FFTW_BACKWARD, FFTW_ESTIMATE));
+  fftw_free(inverseInput);
+  fftw_free(inverseOutput);
+}
+
+void FftwWisdom::startWarmUp() {
+  warmUpFuture = QtConcurrent::run(FftwWisdom::warmUp);
+}
+
+void FftwWisdom::waitForWarmUp() {
+  warmUpFuture.waitForFinished();
+}
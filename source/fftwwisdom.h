@@ -0,0 +1,69 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#ifndef FFTWWISDOM_H
+#define FFTWWISDOM_H
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFuture>
+#include <QMutex>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QString>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+#include <fftw3.h>
+
+#include <keyfinder/constants.h>
+
+/*
+
+FFTW planning is slow the first time a process meets a transform size, and
+libkeyfinder plans afresh in every process. Wisdom (FFTW's record of the
+plans it has made) is kept in a cache file in the user's config directory
+so that later runs can reuse it. A warm-up makes the same plans libkeyfinder
+will, with the same flags, optionally in the background.
+
+FFTW's planner isn't thread-safe and libkeyfinder plans under a lock of its
+own that we can't share, so the mutex here only keeps our own calls apart.
+Analysis waits for the warm-up before it starts, and save() waits for the
+global thread pool, where analysis runs, to finish before exporting.
+
+*/
+
+class FftwWisdom {
+public:
+  static QString cachePath();
+  static bool load(const QString& path = cachePath());
+  static bool save(const QString& path = cachePath());
+  static void warmUp();
+  static void startWarmUp();
+  static void waitForWarmUp();
+private:
+  static QMutex plannerMutex;
+  static QFuture<void> warmUpFuture;
+};
+
+#endif // FFTWWISDOM_H
@@ -0,0 +1,127 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#include "fileprefetcher.h"
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#endif
+
+const int PREFETCH_MAX_THREADS = 4;
+const qint64 PREFETCH_READ_SIZE = 1024 * 1024;
+const qint64 PREFETCH_MAX_BYTES = 32 * 1024 * 1024; // per file
+
+FilePrefetcher::FilePrefetcher(const QStringList& p, int d) : paths(p), depth(d), stopping(0), highestStarted(-1), states(p.size(), PREFETCH_NONE), warmMilliseconds(p.size(), 0), filesWarmed(0), filesWarmedInTime(0), bytesWarmed(0), hiddenMilliseconds(0), exposedMilliseconds(0) {
+  pool.setMaxThreadCount(qBound(1, depth, PREFETCH_MAX_THREADS));
+}
+
+FilePrefetcher::~FilePrefetcher() {
+  stopping.fetchAndStoreOrdered(1);
+  pool.waitForDone();
+}
+
+void FilePrefetcher::beginFile(int index) {
+  if (index < 0 || index >= (signed)states.size()) return;
+  QMutexLocker locker(&mutex);
+  // whatever was read before the job got here is wait it didn't have
+  if (states[index] == PREFETCH_DONE) {
+    hiddenMilliseconds += warmMilliseconds[index];
+    filesWarmedInTime++;
+  }
+  states[index] = PREFETCH_CLAIMED;
+  // jobs are taken in order, so with several workers the files just after
+  // this one may well have been taken already; warm ahead of the furthest
+  // one started instead
+  highestStarted = std::max(highestStarted, index);
+  for (int i = highestStarted + 1; i <= highestStarted + depth && i < (signed)states.size(); i++) {
+    if (states[i] != PREFETCH_NONE) continue;
+    states[i] = PREFETCH_QUEUED;
+    pool.start(new Task(this, i));
+  }
+}
+
+void FilePrefetcher::recordOpen(qint64 milliseconds) {
+  QMutexLocker locker(&mutex);
+  exposedMilliseconds += milliseconds;
+}
+
+void FilePrefetcher::warm(int index) {
+  {
+    QMutexLocker locker(&mutex);
+    // a job that's already started on this file has done its own reading
+    if (states[index] != PREFETCH_QUEUED || stopping.load()) return;
+    states[index] = PREFETCH_RUNNING;
+  }
+  QElapsedTimer timer;
+  timer.start();
+  qint64 bytes = 0;
+  QFile file(paths[index]);
+  if (file.open(QIODevice::ReadOnly)) {
+#if defined(Q_OS_LINUX)
+    posix_fadvise(file.handle(), 0, 0, POSIX_FADV_WILLNEED);
+#elif defined(Q_OS_MAC)
+    fcntl(file.handle(), F_RDAHEAD, 1);
+#endif
+    std::vector<char> buffer(PREFETCH_READ_SIZE);
+    while (bytes < PREFETCH_MAX_BYTES && !stopping.load()) {
+      qint64 read = file.read(&buffer[0], PREFETCH_READ_SIZE);
+      if (read <= 0) break;
+      bytes += read;
+    }
+  }
+  QMutexLocker locker(&mutex);
+  if (states[index] == PREFETCH_RUNNING) states[index] = PREFETCH_DONE;
+  warmMilliseconds[index] = timer.elapsed();
+  filesWarmed++;
+  bytesWarmed += bytes;
+}
+
+int FilePrefetcher::getFilesWarmed() const {
+  QMutexLocker locker(&mutex);
+  return filesWarmed;
+}
+
+int FilePrefetcher::getFilesWarmedInTime() const {
+  QMutexLocker locker(&mutex);
+  return filesWarmedInTime;
+}
+
+qint64 FilePrefetcher::getBytesWarmed() const {
+  QMutexLocker locker(&mutex);
+  return bytesWarmed;
+}
+
+qint64 FilePrefetcher::getHiddenMilliseconds() const {
+  QMutexLocker locker(&mutex);
+  return hiddenMilliseconds;
+}
+
+qint64 FilePrefetcher::getExposedMilliseconds() const {
+  QMutexLocker locker(&mutex);
+  return exposedMilliseconds;
+}
+
+void FilePrefetcher::logMetrics() const {
+  QMutexLocker locker(&mutex);
+  qDebug("Prefetch (depth %d): warmed %d files (%lld MiB), %d ahead of analysis; %lld ms of I/O hidden, %lld ms spent opening files",
+         depth, filesWarmed, bytesWarmed / (1024 * 1024), filesWarmedInTime, hiddenMilliseconds, exposedMilliseconds);
+}
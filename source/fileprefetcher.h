@@ -0,0 +1,95 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#ifndef FILEPREFETCHER_H
+#define FILEPREFETCHER_H
+
+#include <vector>
+#include <algorithm>
+
+#include <QFile>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QRunnable>
+#include <QStringList>
+#include <QThreadPool>
+
+/*
+
+Warms the files a batch is about to analyse. As each file's analysis
+starts, the next few in the queue that no job has started on yet are
+handed to a small I/O pool which
+hints the OS to read them ahead, and reads their heads through the page
+cache regardless (hints count for little on network shares). Timings are
+kept so the batch can report how much I/O wait came off the critical path.
+
+*/
+
+class FilePrefetcher {
+public:
+  FilePrefetcher(const QStringList&, int);
+  ~FilePrefetcher();
+  // called as analysis of file n starts; warms the depth files after the
+  // furthest one started so far
+  void beginFile(int);
+  // time an analysis job spent opening its file, i.e. wait not hidden
+  void recordOpen(qint64);
+  int getFilesWarmed() const;
+  int getFilesWarmedInTime() const;
+  qint64 getBytesWarmed() const;
+  qint64 getHiddenMilliseconds() const;
+  qint64 getExposedMilliseconds() const;
+  void logMetrics() const;
+private:
+  enum prefetch_state_t {
+    PREFETCH_NONE,
+    PREFETCH_QUEUED,
+    PREFETCH_RUNNING,
+    PREFETCH_DONE,
+    PREFETCH_CLAIMED
+  };
+  class Task : public QRunnable {
+  public:
+    Task(FilePrefetcher* p, int i) : prefetcher(p), index(i) { }
+    void run() { prefetcher->warm(index); }
+  private:
+    FilePrefetcher* prefetcher;
+    int index;
+  };
+  void warm(int);
+  QStringList paths;
+  int depth;
+  QThreadPool pool;
+  QAtomicInt stopping;
+  int highestStarted;
+  mutable QMutex mutex;
+  std::vector<prefetch_state_t> states;
+  std::vector<qint64> warmMilliseconds;
+  int filesWarmed;
+  int filesWarmedInTime;
+  qint64 bytesWarmed;
+  qint64 hiddenMilliseconds;
+  qint64 exposedMilliseconds;
+};
+
+#endif // FILEPREFETCHER_H
@@ -28,6 +28,10 @@ const QString STATUS_TAGSREAD = "-2";
 const QString STATUS_SKIPPED = "-3";
 const QString STATUS_FAILED = "-4";
 
+// a CUE sheet track's row holds its range of the image in the file path item
+const int ROLE_TRACK_START = Qt::UserRole;
+const int ROLE_TRACK_END = Qt::UserRole + 1;
+
 /*
  * This typedef and the qRegisterMetaType below stop the appearance of an
  * inexplicable qWarning during the first call to addNewRow: "Cannot queue
@@ -35,7 +39,7 @@ const QString STATUS_FAILED = "-4";
  */
 typedef QVector<int> MyArray;
 
-BatchWindow::BatchWindow(QWidget* parent, MainMenuHandler* handler) : QMainWindow(parent), readLibraryWatcher(NULL), loadPlaylistWatcher(NULL), addFilesWatcher(NULL), metadataReadWatcher(NULL), analysisWatcher(NULL), ui(new Ui::BatchWindow), metadataColumnMapping(METADATA_TAG_T_COUNT) {
+BatchWindow::BatchWindow(QWidget* parent, MainMenuHandler* handler) : QMainWindow(parent), readLibraryWatcher(NULL), loadPlaylistWatcher(NULL), addFilesWatcher(NULL), metadataReadWatcher(NULL), analysisWatcher(NULL), analysisResults(NULL), analysisPrefetcher(NULL), ui(new Ui::BatchWindow), metadataColumnMapping(METADATA_TAG_T_COUNT) {
   // ASYNC
   qRegisterMetaType<MyArray>("MyArray");
 
@@ -46,6 +50,7 @@ BatchWindow::BatchWindow(QWidget* parent, MainMenuHandler* handler) : QMainWindo
   menuHandler = handler;
   ui->tableWidget->setColumnHidden(COL_FILEPATH, true);
   ui->tableWidget->setColumnHidden(COL_STATUS, true);
+  ui->tableWidget->setColumnHidden(COL_KEY_TIMELINE, prefs.getKeyTimelineSeconds() == 0);
   ui->splitter->setStretchFactor(0, 1);
   ui->splitter->setStretchFactor(1, 3);
   ui->splitter->setCollapsible(0, true);
@@ -159,6 +164,8 @@ BatchWindow::~BatchWindow() {
     analysisWatcher->cancel();
     analysisWatcher->waitForFinished();
   }
+  delete analysisResults;
+  delete analysisPrefetcher;
   delete ui;
 }
 
@@ -361,6 +368,9 @@ void BatchWindow::addDroppedFiles() {
     } else if (fileExt == "xml") {
       droppedFiles << ExternalPlaylistProvider::readITunesStandalonePlaylist(filePath);
       continue;
+    } else if (fileExt == "cue") {
+      addCueSheetRows(filePath);
+      continue;
     }
 
     // check if it matches the extension filters
@@ -424,6 +434,7 @@ void BatchWindow::addNewRow(QString fileUrl) {
   ui->tableWidget->setItem(newRow, COL_FILEPATH,     new QTableWidgetItem());
   ui->tableWidget->setItem(newRow, COL_FILENAME,     new QTableWidgetItem());
   ui->tableWidget->setItem(newRow, COL_DETECTED_KEY, new QTableWidgetItem());
+  ui->tableWidget->setItem(newRow, COL_KEY_TIMELINE, new QTableWidgetItem());
   ui->tableWidget->item(newRow, COL_STATUS)->setText(STATUS_NEW);
   ui->tableWidget->item(newRow, COL_FILEPATH)->setText(fileUrl);
   ui->tableWidget->item(newRow, COL_FILENAME)->setText(fileUrl.mid(fileUrl.lastIndexOf("/") + 1)); // note forwardslash not QDir::separator
@@ -434,6 +445,40 @@ void BatchWindow::addNewRow(QString fileUrl) {
   }
 }
 
+// a row per audio track, ready for analysis; the tags come from the sheet.
+// The image gets no row of its own, so one that's already there goes.
+void BatchWindow::addCueSheetRows(const QString& cuePath) {
+  CueSheet cue(cuePath);
+  foreach (const CueTrack& track, cue.getTracks()) {
+    bool isNewTrack = true;
+    for (int j = ui->tableWidget->rowCount() - 1; j >= 0; j--) {
+      if (ui->tableWidget->item(j, COL_FILEPATH)->text() != track.filePath) continue;
+      if (!isTrackRow(j)) {
+        ui->tableWidget->removeRow(j);
+      } else if (ui->tableWidget->item(j, COL_FILEPATH)->data(ROLE_TRACK_START).toDouble() == track.startSeconds) {
+        isNewTrack = false;
+      }
+    }
+    if (!isNewTrack) continue;
+
+    addNewRow(track.filePath);
+    int row = ui->tableWidget->rowCount() - 1;
+    ui->tableWidget->item(row, COL_STATUS)->setText(STATUS_TAGSREAD);
+    ui->tableWidget->item(row, COL_FILEPATH)->setData(ROLE_TRACK_START, track.startSeconds);
+    ui->tableWidget->item(row, COL_FILEPATH)->setData(ROLE_TRACK_END, track.endSeconds);
+    QString fileName = ui->tableWidget->item(row, COL_FILENAME)->text();
+    //: File name of a track of a CUE sheet in the Batch window; the image file at %1 and the track number at %2
+    ui->tableWidget->item(row, COL_FILENAME)->setText(tr("%1 (track %2)").arg(fileName).arg(track.number, 2, 10, QChar('0')));
+    ui->tableWidget->setItem(row, COL_TAG_TITLE,  new QTableWidgetItem(track.title));
+    ui->tableWidget->setItem(row, COL_TAG_ARTIST, new QTableWidgetItem(track.performer));
+    ui->tableWidget->setItem(row, COL_TAG_ALBUM,  new QTableWidgetItem(cue.getTitle()));
+  }
+}
+
+bool BatchWindow::isTrackRow(int row) const {
+  return ui->tableWidget->item(row, COL_FILEPATH)->data(ROLE_TRACK_START).isValid();
+}
+
 void BatchWindow::addFilesFinished() {
   delete addFilesWatcher;
   addFilesWatcher = NULL;
@@ -561,16 +606,51 @@ void BatchWindow::markRowSkipped(int row, bool skip) {
 }
 
 void BatchWindow::runAnalysis() {
-  QList<AsyncFileObject> objects;
+  QList<int> rows;
+  QStringList paths;
+  // the tracks of a CUE sheet's image go to one job, so it's decoded once
+  QList<QList<TrackRange> > tracks;
+  QHash<QString, int> imageJobs;
   for (int row = 0; row < ui->tableWidget->rowCount(); row++) {
     QString status = ui->tableWidget->item(row, COL_STATUS)->text();
     if (status == STATUS_NEW || status == STATUS_TAGSREAD) {
-      objects.push_back(AsyncFileObject(ui->tableWidget->item(row, COL_FILEPATH)->text(), prefs, row));
+      QString path = ui->tableWidget->item(row, COL_FILEPATH)->text();
+      QList<TrackRange> rowTracks;
+      if (isTrackRow(row)) {
+        QTableWidgetItem* item = ui->tableWidget->item(row, COL_FILEPATH);
+        rowTracks.push_back(TrackRange(item->data(ROLE_TRACK_START).toDouble(), item->data(ROLE_TRACK_END).toDouble(), row));
+        if (imageJobs.contains(path)) {
+          tracks[imageJobs[path]] << rowTracks;
+          continue;
+        }
+        imageJobs.insert(path, paths.size());
+      }
+      rows.push_back(row);
+      paths.push_back(path);
+      tracks.push_back(rowTracks);
     }
   }
-  QFuture<KeyFinderResultWrapper> analysisFuture = QtConcurrent::mapped(objects, keyDetectionProcess);
-  analysisWatcher = new QFutureWatcher<KeyFinderResultWrapper>();
-  connect(analysisWatcher, SIGNAL(resultReadyAt(int)),             this, SLOT(analysisResultReadyAt(int)));
+  if (prefs.getKeyTimelineSeconds() > 0) {
+    ui->tableWidget->setColumnHidden(COL_KEY_TIMELINE, false);
+  }
+  // jobs are taken from the front of the queue, so as each starts the next
+  // few files are read ahead while it's busy with the CPU
+  if (prefs.getPrefetchDepth() > 0) {
+    analysisPrefetcher = new FilePrefetcher(paths, prefs.getPrefetchDepth());
+  }
+  // results come back through a queue rather than the future, which would
+  // keep every one of them until the whole batch was done
+  analysisResults = new AnalysisResultQueue();
+  connect(analysisResults, SIGNAL(resultsReady()), this, SLOT(analysisResultsReady()), Qt::QueuedConnection);
+  analysisObjects.clear();
+  for (int i = 0; i < rows.size(); i++) {
+    AsyncFileObject object(paths[i], prefs, rows[i], analysisPrefetcher, i);
+    object.resultQueue = analysisResults;
+    object.tracks = tracks[i];
+    analysisObjects.push_back(object);
+  }
+  QFuture<void> analysisFuture = QtConcurrent::map(analysisObjects, queuedKeyDetectionProcess);
+  analysisWatcher = new QFutureWatcher<void>();
   connect(analysisWatcher, SIGNAL(finished()),                     this, SLOT(analysisFinished())); // takes care of cancelled too
   connect(analysisWatcher, SIGNAL(progressRangeChanged(int, int)), this, SLOT(progressRangeChanged(int, int)));
   connect(analysisWatcher, SIGNAL(progressValueChanged(int)),      this, SLOT(progressValueChanged(int)));
@@ -588,13 +668,26 @@ void BatchWindow::on_cancelBatchButton_clicked() {
   }
 }
 
-void BatchWindow::analysisResultReadyAt(int index) {
-  QString error = analysisWatcher->resultAt(index).errorMessage;
-  int row = analysisWatcher->resultAt(index).batchRow;
+void BatchWindow::analysisResultsReady() {
+  if (analysisResults == NULL) return; // batch already finished and drained
+  std::unique_ptr<KeyFinderResultWrapper> result;
+  while ((result = analysisResults->take()) != NULL) {
+    showAnalysisResult(*result);
+  }
+}
+
+void BatchWindow::showAnalysisResult(const KeyFinderResultWrapper& result) {
+  QString error = result.errorMessage;
+  int row = result.batchRow;
   if (error.isEmpty()) {
-    KeyFinder::key_t key = analysisWatcher->resultAt(index).core;
+    KeyFinder::key_t key = result.core;
     ui->tableWidget->item(row, COL_STATUS)->setText(QString::number(key));
     ui->tableWidget->item(row, COL_DETECTED_KEY)->setText(prefs.getKeyCode(key));
+    ui->tableWidget->item(row, COL_KEY_TIMELINE)->setText(KeyTimeline::describe(result.keyTimeline, prefs, ", "));
+    if (result.secondsAnalysed < result.durationSeconds - 1.0) {
+      //: Tooltip on a detected key when only part of the file was analysed
+      ui->tableWidget->item(row, COL_DETECTED_KEY)->setToolTip(tr("From %1 of %2 seconds of audio").arg((int) result.secondsAnalysed).arg((int) result.durationSeconds));
+    }
     if (prefs.getWriteToFilesAutomatically()) {
       writeToTagsAtRow(row, key);
       writeToFilenameAtRow(row, key);
@@ -611,6 +704,16 @@ void BatchWindow::analysisResultReadyAt(int index) {
 void BatchWindow::analysisFinished() {
   delete analysisWatcher;
   analysisWatcher = NULL;
+  // the last wake-up may still be queued behind this
+  analysisResultsReady();
+  delete analysisResults;
+  analysisResults = NULL;
+  analysisObjects.clear();
+  if (analysisPrefetcher != NULL) {
+    analysisPrefetcher->logMetrics();
+    delete analysisPrefetcher;
+    analysisPrefetcher = NULL;
+  }
   setGuiDefaults();
   QApplication::beep();
 }
@@ -656,6 +759,7 @@ void BatchWindow::writeDetectedToFiles() {
 }
 
 bool BatchWindow::writeToTagsAtRow(int row, KeyFinder::key_t key) {
+  if (isTrackRow(row)) return false; // its tags would be the whole image's
   AVFileMetadataFactory factory;
   AVFileMetadata* md = factory.createAVFileMetadata(ui->tableWidget->item(row, COL_FILEPATH)->text());
   MetadataWriteResult written = md->writeKeyToMetadata(key, prefs);
@@ -679,6 +783,7 @@ bool BatchWindow::writeToTagsAtRow(int row, KeyFinder::key_t key) {
 }
 
 bool BatchWindow::writeToFilenameAtRow(int row, KeyFinder::key_t key) {
+  if (isTrackRow(row)) return false;
 
   QString currentFilename = ui->tableWidget->item(row, COL_FILEPATH)->text();
   QStringList newFilename = writeKeyToFilename(currentFilename, key, prefs);
@@ -706,6 +811,7 @@ void BatchWindow::clearDetected() {
       if (ui->tableWidget->item(row, COL_DETECTED_KEY) != 0) {
         ui->tableWidget->item(row, COL_STATUS)->setText(STATUS_TAGSREAD);
         ui->tableWidget->item(row, COL_DETECTED_KEY)->setText("");
+        ui->tableWidget->item(row, COL_KEY_TIMELINE)->setText("");
         // clear text colours
         for (int col = 0; col < ui->tableWidget->columnCount(); col++)
           if (!ui->tableWidget->isColumnHidden(col))
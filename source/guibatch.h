@@ -45,6 +45,7 @@ class MainMenuHandler;
 #include "asyncmetadatareadprocess.h"
 #include "metadatafilename.h"
 #include "externalplaylistprovider.h"
+#include "cuesheet.h"
 #include "_VERSION.h"
 
 enum playlist_columns_t{
@@ -61,7 +62,8 @@ enum track_columns_t{
   COL_TAG_COMMENT,
   COL_TAG_GROUPING,
   COL_TAG_KEY,
-  COL_DETECTED_KEY
+  COL_DETECTED_KEY,
+  COL_KEY_TIMELINE
 };
 
 namespace Ui {
@@ -103,14 +105,20 @@ private:
   QList<QUrl> getDirectoryContents(QDir) const;
 
   void addNewRow(QString);
+  void addCueSheetRows(const QString&);
+  bool isTrackRow(int) const;
   QFutureWatcher<MetadataReadResult>* metadataReadWatcher;
   void readMetadata();
 
-  QFutureWatcher<KeyFinderResultWrapper>* analysisWatcher;
+  QFutureWatcher<void>* analysisWatcher;
+  AnalysisResultQueue* analysisResults;
+  QList<AsyncFileObject> analysisObjects; // must outlive analysisWatcher's future
+  FilePrefetcher* analysisPrefetcher;
   void checkRowsForSkipping();
   bool fieldAlreadyHasKeyData(int, int, metadata_write_t);
   void markRowSkipped(int,bool);
   void runAnalysis();
+  void showAnalysisResult(const KeyFinderResultWrapper&);
 
   bool writeToTagsAtRow(int, KeyFinder::key_t);
   bool writeToFilenameAtRow(int, KeyFinder::key_t);
@@ -144,7 +152,7 @@ private slots:
   void deleteSelectedRows();
 
   void analysisFinished();
-  void analysisResultReadyAt(int);
+  void analysisResultsReady();
 
   void metadataReadFinished();
   void metadataReadResultReadyAt(int);
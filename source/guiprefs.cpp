@@ -46,6 +46,23 @@ PrefsDialog::PrefsDialog(QWidget *parent): QDialog(parent),ui(new Ui::PrefsDialo
   ui->skipFilesWithExistingTags->setChecked(p.getSkipFilesWithExistingTags());
   ui->applyFileExtensionFilter->setChecked(p.getApplyFileExtensionFilter());
   ui->maxDuration->setValue(p.getMaxDuration());
+  ui->fastScan->setChecked(p.getFastScan());
+  ui->fastScanWindows->setValue(p.getFastScanWindows());
+  ui->fastScanWindowSeconds->setValue(p.getFastScanWindowSeconds());
+  ui->prefetchDepth->setValue(p.getPrefetchDepth());
+  ui->pipelineDecode->setChecked(p.getPipelineDecode());
+  ui->streamLongFiles->setChecked(p.getStreamLongFiles());
+  ui->fftwWarmUp->setChecked(p.getFftwWarmUp());
+  ui->keyTimelineSeconds->setValue(p.getKeyTimelineSeconds());
+  ui->parallelChunkMinutes->setValue(p.getParallelChunkMinutes());
+  ui->earlyStop->setChecked(p.getEarlyStop());
+  ui->earlyStopMargin->setValue(p.getEarlyStopMargin());
+  ui->earlyStopSeconds->setValue(p.getEarlyStopSeconds());
+  ui->resultCache->setChecked(p.getResultCache());
+  ui->resultCacheHash->setChecked(p.getResultCacheHash());
+  ui->storeChromagrams->setChecked(p.getStoreChromagrams());
+  ui->silenceGate->setChecked(p.getSilenceGate());
+  ui->silenceThreshold->setValue(p.getSilenceThreshold());
 
   ui->tagFormat->setCurrentIndex(listMetadataFormat.indexOf(p.getMetadataFormat()));
   ui->metadataWriteTitle->setCurrentIndex(listMetadataWrite.indexOf(p.getMetadataWriteTitle()));
@@ -81,6 +98,7 @@ PrefsDialog::PrefsDialog(QWidget *parent): QDialog(parent),ui(new Ui::PrefsDialo
   // enable/disable fields as necessary
   metadataDelimiterEnabled();
   applyFileExtensionFilterEnabled();
+  fastScanEnabled();
 
   //relative sizing on Mac/Linux only
 #ifndef Q_OS_WIN
@@ -119,6 +137,23 @@ void PrefsDialog::on_savePrefsButton_clicked() {
   p.setMetadataDelimiter(ui->metadataDelimiter->text());
   p.setSkipFilesWithExistingTags(ui->skipFilesWithExistingTags->isChecked());
   p.setMaxDuration(ui->maxDuration->value());
+  p.setFastScan(ui->fastScan->isChecked());
+  p.setFastScanWindows(ui->fastScanWindows->value());
+  p.setFastScanWindowSeconds(ui->fastScanWindowSeconds->value());
+  p.setPrefetchDepth(ui->prefetchDepth->value());
+  p.setPipelineDecode(ui->pipelineDecode->isChecked());
+  p.setStreamLongFiles(ui->streamLongFiles->isChecked());
+  p.setFftwWarmUp(ui->fftwWarmUp->isChecked());
+  p.setKeyTimelineSeconds(ui->keyTimelineSeconds->value());
+  p.setParallelChunkMinutes(ui->parallelChunkMinutes->value());
+  p.setEarlyStop(ui->earlyStop->isChecked());
+  p.setEarlyStopMargin(ui->earlyStopMargin->value());
+  p.setEarlyStopSeconds(ui->earlyStopSeconds->value());
+  p.setResultCache(ui->resultCache->isChecked());
+  p.setResultCacheHash(ui->resultCacheHash->isChecked());
+  p.setStoreChromagrams(ui->storeChromagrams->isChecked());
+  p.setSilenceGate(ui->silenceGate->isChecked());
+  p.setSilenceThreshold(ui->silenceThreshold->value());
   p.setITunesLibraryPath(ui->iTunesLibraryPath->text());
   p.setTraktorLibraryPath(ui->traktorLibraryPath->text());
   p.setSeratoLibraryPath(ui->seratoLibraryPath->text());
@@ -172,6 +207,11 @@ void PrefsDialog::applyFileExtensionFilterEnabled() {
   ui->filterFileExtensions->setEnabled(ui->applyFileExtensionFilter->isChecked());
 }
 
+void PrefsDialog::fastScanEnabled() {
+  ui->fastScanWindows->setEnabled(ui->fastScan->isChecked());
+  ui->fastScanWindowSeconds->setEnabled(ui->fastScan->isChecked());
+}
+
 void PrefsDialog::on_metadataWriteTitle_currentIndexChanged(int /*index*/) {
   metadataDelimiterEnabled();
 }
@@ -204,6 +244,10 @@ void PrefsDialog::on_applyFileExtensionFilter_stateChanged(int /*state*/) {
   applyFileExtensionFilterEnabled();
 }
 
+void PrefsDialog::on_fastScan_stateChanged(int /*state*/) {
+  fastScanEnabled();
+}
+
 void PrefsDialog::on_findITunesLibraryButton_clicked() {
   QString initDir;
 #ifdef Q_OS_WIN
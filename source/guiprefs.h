@@ -45,6 +45,7 @@ private:
   // altering state on field changes
   void metadataDelimiterEnabled();
   void applyFileExtensionFilterEnabled();
+  void fastScanEnabled();
 private slots:
   void on_savePrefsButton_clicked();
   void on_cancelButton_clicked();
@@ -59,6 +60,7 @@ private slots:
   void on_metadataWriteKey_currentIndexChanged(int index);
   void on_metadataWriteFilename_currentIndexChanged(int index);
   void on_applyFileExtensionFilter_stateChanged(int state);
+  void on_fastScan_stateChanged(int state);
 private:
   Ui::PrefsDialog *ui;
 };
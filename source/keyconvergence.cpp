@@ -0,0 +1,100 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "keyconvergence.h"
+
+static const double MAJOR_PROFILE[12] = { 6.35, 2.23, 3.48, 2.33, 4.38, 4.09, 2.52, 5.19, 2.39, 3.66, 2.29, 2.88 };
+static const double MINOR_PROFILE[12] = { 6.33, 2.68, 3.52, 5.38, 2.60, 3.53, 2.54, 4.75, 3.98, 2.69, 3.34, 3.17 };
+
+static double correlation(const double* profile, const double* chroma, unsigned int tonic) {
+  double profileMean = 0.0, chromaMean = 0.0;
+  for (unsigned int i = 0; i < 12; i++) {
+    profileMean += profile[i] / 12.0;
+    chromaMean += chroma[i] / 12.0;
+  }
+  double covariance = 0.0, profileVariance = 0.0, chromaVariance = 0.0;
+  for (unsigned int i = 0; i < 12; i++) {
+    double p = profile[i] - profileMean;
+    double c = chroma[(i + tonic) % 12] - chromaMean;
+    covariance += p * c;
+    profileVariance += p * p;
+    chromaVariance += c * c;
+  }
+  if (profileVariance <= 0.0 || chromaVariance <= 0.0) return 0.0;
+  return covariance / sqrt(profileVariance * chromaVariance);
+}
+
+KeyConvergence::KeyConvergence(KeyFinder::KeyFinder& kf, double m, double s) : keyFinder(kf), margin(m), span(s), hops(0), stableKey(KeyFinder::SILENCE), stableSince(0.0), converged(false) { }
+
+void KeyConvergence::addHops(const KeyFinder::Workspace& workspace, unsigned int firstHop, double secondsAnalysed) {
+  const KeyFinder::Chromagram* c = workspace.chromagram;
+  if (c != NULL) {
+    if (sums.size() < c->getBands()) sums.resize(c->getBands(), 0.0);
+    for (unsigned int h = firstHop; h < c->getHops(); h++) {
+      for (unsigned int b = 0; b < c->getBands(); b++) {
+        sums[b] += c->getMagnitude(h, b);
+      }
+      hops++;
+    }
+  }
+  if (hops == 0) {
+    stableSince = secondsAnalysed;
+    return;
+  }
+
+  KeyFinder::Workspace w;
+  w.chromagram = new KeyFinder::Chromagram(1);
+  for (unsigned int b = 0; b < sums.size() && b < w.chromagram->getBands(); b++) {
+    w.chromagram->setMagnitude(0, b, sums[b] / hops);
+  }
+  KeyFinder::key_t key = keyFinder.keyOfChromagram(w);
+
+  if (key != stableKey || key == KeyFinder::SILENCE || leadOfBestKey(sums) < margin) {
+    stableKey = key;
+    stableSince = secondsAnalysed;
+    converged = false;
+  } else {
+    converged = secondsAnalysed - stableSince >= span;
+  }
+}
+
+bool KeyConvergence::hasConverged() const {
+  return converged;
+}
+
+double KeyConvergence::leadOfBestKey(const std::vector<double>& bands) {
+  // bands run up from A a semitone at a time
+  double chroma[12] = { 0.0 };
+  for (unsigned int b = 0; b < bands.size(); b++) chroma[b % 12] += bands[b];
+  double best = -1.0, next = -1.0;
+  for (unsigned int tonic = 0; tonic < 12; tonic++) {
+    for (unsigned int mode = 0; mode < 2; mode++) {
+      double r = correlation(mode == 0 ? MAJOR_PROFILE : MINOR_PROFILE, chroma, tonic);
+      if (r > best) {
+        next = best;
+        best = r;
+      } else if (r > next) {
+        next = r;
+      }
+    }
+  }
+  return best - next;
+}
@@ -0,0 +1,64 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#ifndef KEYCONVERGENCE_H
+#define KEYCONVERGENCE_H
+
+#include <math.h>
+#include <vector>
+
+#include "keyfinder/keyfinder.h"
+
+/*
+
+Decides when a file's key estimate has settled, so decoding can stop early.
+It keeps a running mean of the chromagram and, after each chunk, checks the
+key it classifies to. The estimate has converged once that key has held for
+a given span of audio and led the runner-up all the while by a margin. The
+margin is measured on the mean folded to twelve pitch classes and correlated
+with the Krumhansl-Kessler profiles; that's cheap, and only gates stopping.
+The key itself still comes from KeyFinder.
+
+*/
+
+class KeyConvergence {
+public:
+  // margin is a difference in correlation, 0-1; span is in seconds
+  KeyConvergence(KeyFinder::KeyFinder&, double margin, double span);
+  // folds in hops [firstHop, end) of the workspace's chromagram, then
+  // re-evaluates the estimate as of secondsAnalysed
+  void addHops(const KeyFinder::Workspace&, unsigned int firstHop, double secondsAnalysed);
+  bool hasConverged() const;
+  // correlation of the best key profile less that of the next best
+  static double leadOfBestKey(const std::vector<double>& bands);
+private:
+  KeyFinder::KeyFinder& keyFinder;
+  double margin;
+  double span;
+  std::vector<double> sums;
+  unsigned int hops;
+  KeyFinder::key_t stableKey;
+  double stableSince;
+  bool converged;
+};
+
+#endif // KEYCONVERGENCE_H
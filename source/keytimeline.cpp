@@ -0,0 +1,89 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "keytimeline.h"
+#include "preferences.h"
+
+KeyTimeline::KeyTimeline(KeyFinder::KeyFinder& kf, double s, double start) : keyFinder(kf), segmentSeconds(s), segmentStart(start), hops(0) { }
+
+void KeyTimeline::addHops(const KeyFinder::Workspace& workspace, unsigned int firstHop, double secondsAnalysed) {
+  const KeyFinder::Chromagram* c = workspace.chromagram;
+  if (c != NULL) {
+    if (sums.size() < c->getBands()) sums.resize(c->getBands(), 0.0);
+    for (unsigned int h = firstHop; h < c->getHops(); h++) {
+      for (unsigned int b = 0; b < c->getBands(); b++) {
+        sums[b] += c->getMagnitude(h, b);
+      }
+      hops++;
+    }
+  }
+  if (secondsAnalysed - segmentStart >= segmentSeconds) closeSegment(secondsAnalysed);
+}
+
+void KeyTimeline::finish(double secondsAnalysed) {
+  if (hops > 0) {
+    closeSegment(secondsAnalysed);
+  } else if (!segments.empty()) {
+    segments.back().endSeconds = secondsAnalysed;
+  }
+}
+
+const std::vector<KeySegment>& KeyTimeline::getSegments() const {
+  return segments;
+}
+
+void KeyTimeline::closeSegment(double endSeconds) {
+  // the chromagram lags the audio by up to a frame; let it catch up
+  if (hops == 0) return;
+  KeyFinder::Workspace w;
+  w.chromagram = new KeyFinder::Chromagram(1);
+  for (unsigned int b = 0; b < sums.size() && b < w.chromagram->getBands(); b++) {
+    w.chromagram->setMagnitude(0, b, sums[b] / hops);
+  }
+  KeyFinder::key_t key = keyFinder.keyOfChromagram(w);
+  if (!segments.empty() && segments.back().key == key) {
+    segments.back().endSeconds = endSeconds;
+  } else {
+    segments.push_back(KeySegment(segmentStart, endSeconds, key));
+  }
+  std::fill(sums.begin(), sums.end(), 0.0);
+  hops = 0;
+  segmentStart = endSeconds;
+}
+
+void KeyTimeline::append(std::vector<KeySegment>& timeline, const std::vector<KeySegment>& later) {
+  for (unsigned int i = 0; i < later.size(); i++) {
+    if (!timeline.empty() && timeline.back().key == later[i].key) {
+      timeline.back().endSeconds = later[i].endSeconds;
+    } else {
+      timeline.push_back(later[i]);
+    }
+  }
+}
+
+QString KeyTimeline::describe(const std::vector<KeySegment>& segments, const Preferences& prefs, const QString& separator) {
+  QStringList parts;
+  for (unsigned int i = 0; i < segments.size(); i++) {
+    int start = (int) segments[i].startSeconds;
+    parts << QString("%1:%2 %3").arg(start / 60).arg(start % 60, 2, 10, QChar('0')).arg(prefs.getKeyCode(segments[i].key));
+  }
+  return parts.join(separator);
+}
@@ -0,0 +1,75 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#ifndef KEYTIMELINE_H
+#define KEYTIMELINE_H
+
+#include <vector>
+
+#include <QString>
+#include <QStringList>
+
+#include "keyfinder/keyfinder.h"
+
+class Preferences;
+
+class KeySegment {
+public:
+  KeySegment(double s, double e, KeyFinder::key_t k) : startSeconds(s), endSeconds(e), key(k) { }
+  double startSeconds;
+  double endSeconds;
+  KeyFinder::key_t key;
+};
+
+/*
+
+Where the key changes within a file. Fed the chromagram's new hops after
+each decoded chunk, it classifies fixed-length stretches of audio as they
+complete and merges neighbours that come out in the same key, so the
+timeline falls out of the single analysis pass. Stretch boundaries land on
+chunk boundaries, which are a few seconds apart.
+
+*/
+
+class KeyTimeline {
+public:
+  KeyTimeline(KeyFinder::KeyFinder&, double segmentSeconds, double startSeconds = 0.0);
+  // folds in hops [firstHop, end) of the workspace's chromagram, then
+  // closes the current stretch if the audio so far reaches its end
+  void addHops(const KeyFinder::Workspace&, unsigned int firstHop, double secondsAnalysed);
+  // closes whatever's left at the end of the file
+  void finish(double secondsAnalysed);
+  const std::vector<KeySegment>& getSegments() const;
+  // joins a later part of the file's timeline on to an earlier one
+  static void append(std::vector<KeySegment>&, const std::vector<KeySegment>&);
+  static QString describe(const std::vector<KeySegment>&, const Preferences&, const QString& separator);
+private:
+  void closeSegment(double endSeconds);
+  KeyFinder::KeyFinder& keyFinder;
+  double segmentSeconds;
+  double segmentStart;
+  std::vector<double> sums;
+  unsigned int hops;
+  std::vector<KeySegment> segments;
+};
+
+#endif // KEYTIMELINE_H
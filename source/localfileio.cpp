@@ -0,0 +1,189 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#include "localfileio.h"
+
+#include <cstring>
+#include <errno.h>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#if defined(Q_OS_LINUX)
+#include <sys/vfs.h>
+#elif defined(Q_OS_MAC)
+#include <sys/param.h>
+#include <sys/mount.h>
+#elif defined(Q_OS_WIN)
+#include <windows.h>
+#endif
+
+const int MAPPED_BUFFER_SIZE = 256 * 1024;
+const int READ_BUFFER_SIZE = 1024 * 1024;
+const qint64 RELEASE_THRESHOLD = 8 * 1024 * 1024;
+
+LocalFileIO::LocalFileIO(const QString& path) : file(path), map(NULL), size(0), position(0), released(0), ioCtx(NULL) {
+  // pipes and devices have no size to read up to
+  if (!QFileInfo(path).isFile()) {
+    return;
+  }
+  if (!file.open(QIODevice::ReadOnly)) {
+    return;
+  }
+  size = file.size();
+  // a mapped file that's truncated or replaced on a server raises SIGBUS
+  // rather than a read error, so only local files are mapped
+  if (onLocalFilesystem()) map = file.map(0, size);
+  adviseSequential();
+  // with a mapping, libav's buffer is just a window onto it so it can stay
+  // small; without, it determines how much is read per syscall
+  int bufferSize = (map != NULL ? MAPPED_BUFFER_SIZE : READ_BUFFER_SIZE);
+  unsigned char* buffer = (unsigned char*) av_malloc(bufferSize);
+  if (buffer == NULL) {
+    file.close();
+    return;
+  }
+  ioCtx = avio_alloc_context(buffer, bufferSize, 0, this, LocalFileIO::read, NULL, LocalFileIO::seek);
+  if (ioCtx == NULL) {
+    av_free(buffer);
+    file.close();
+  }
+}
+
+LocalFileIO::~LocalFileIO() {
+  if (ioCtx != NULL) {
+    av_free(ioCtx->buffer);
+    av_free(ioCtx);
+  }
+  if (map != NULL) file.unmap(map);
+  file.close();
+}
+
+bool LocalFileIO::isOpen() const {
+  return ioCtx != NULL;
+}
+
+bool LocalFileIO::isMapped() const {
+  return map != NULL;
+}
+
+AVIOContext* LocalFileIO::getContext() const {
+  return ioCtx;
+}
+
+bool LocalFileIO::onLocalFilesystem() {
+#if defined(Q_OS_LINUX)
+  struct statfs fs;
+  if (fstatfs(file.handle(), &fs) != 0) return false;
+  switch ((quint32) fs.f_type) {
+  case 0x00006969: // NFS
+  case 0x0000517b: // SMB
+  case 0xff534d42: // CIFS
+  case 0xfe534d42: // SMB2
+  case 0x65735546: // FUSE
+  case 0x73757245: // Coda
+  case 0x5346414f: // AFS
+  case 0x01021997: // 9P
+  case 0x00c36400: // Ceph
+    return false;
+  }
+  return true;
+#elif defined(Q_OS_MAC)
+  struct statfs fs;
+  return fstatfs(file.handle(), &fs) == 0 && (fs.f_flags & MNT_LOCAL) != 0;
+#elif defined(Q_OS_WIN)
+  QString native = QDir::toNativeSeparators(QFileInfo(file).absoluteFilePath());
+  if (native.startsWith("\\\\")) return false; // UNC path
+  return GetDriveTypeW(reinterpret_cast<const wchar_t*>(native.left(3).utf16())) != DRIVE_REMOTE;
+#else
+  return false;
+#endif
+}
+
+void LocalFileIO::adviseSequential() {
+#if defined(Q_OS_LINUX)
+  posix_fadvise(file.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#elif defined(Q_OS_MAC)
+  fcntl(file.handle(), F_RDAHEAD, 1);
+#endif
+#ifdef Q_OS_UNIX
+  if (map != NULL) madvise(map, size, MADV_SEQUENTIAL);
+#endif
+}
+
+void LocalFileIO::releaseMapped(const uchar* start, const uchar* end) {
+#ifdef Q_OS_UNIX
+  quintptr page = (quintptr) sysconf(_SC_PAGESIZE);
+  quintptr first = ((quintptr) start + page - 1) & ~(page - 1);
+  quintptr last = (quintptr) end & ~(page - 1);
+  if (last > first) madvise((void*) first, last - first, MADV_DONTNEED);
+#else
+  Q_UNUSED(start);
+  Q_UNUSED(end);
+#endif
+}
+
+int LocalFileIO::read(void* opaque, uint8_t* buffer, int bufferSize) {
+  LocalFileIO* io = static_cast<LocalFileIO*>(opaque);
+  qint64 remaining = io->size - io->position;
+  if (remaining <= 0) return 0; // EOF
+  int bytes = (int) qMin((qint64) bufferSize, remaining);
+  if (io->map != NULL) {
+    memcpy(buffer, io->map + io->position, bytes);
+  } else {
+    bytes = (int) io->file.read((char*) buffer, bytes);
+    if (bytes < 0) return AVERROR(EIO);
+  }
+  io->position += bytes;
+  // keep long files from accumulating in the resident set as they're read
+  if (io->map != NULL && io->position - io->released > RELEASE_THRESHOLD) {
+    releaseMapped(io->map + io->released, io->map + io->position);
+    io->released = io->position;
+  }
+  return bytes;
+}
+
+int64_t LocalFileIO::seek(void* opaque, int64_t offset, int whence) {
+  LocalFileIO* io = static_cast<LocalFileIO*>(opaque);
+  if (whence & AVSEEK_SIZE) return io->size;
+  qint64 target;
+  switch (whence & ~AVSEEK_FORCE) {
+  case SEEK_SET:
+    target = offset;
+    break;
+  case SEEK_CUR:
+    target = io->position + offset;
+    break;
+  case SEEK_END:
+    target = io->size + offset;
+    break;
+  default:
+    return -1;
+  }
+  if (target < 0 || target > io->size) return -1;
+  if (io->map == NULL && !io->file.seek(target)) return -1;
+  io->position = target;
+  return target;
+}
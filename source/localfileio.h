@@ -0,0 +1,70 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#ifndef LOCALFILEIO_H
+#define LOCALFILEIO_H
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QString>
+
+extern "C"{
+#include <libavutil/error.h>
+#include <libavutil/mem.h>
+#include <libavformat/avio.h>
+}
+
+/*
+
+Custom I/O for libav when reading regular files. Files on a local
+filesystem are memory-mapped where possible; others, and any that can't be
+mapped, are read in large aligned chunks. Either way the OS is told the
+access will be sequential. If the file can't be opened, or isn't a regular
+file, the decoder falls back to libav's own file protocol.
+
+*/
+
+class LocalFileIO {
+public:
+  LocalFileIO(const QString&);
+  ~LocalFileIO();
+  bool isOpen() const;
+  bool isMapped() const;
+  AVIOContext* getContext() const;
+  // drops whole pages of a read-only mapping from the process; they're
+  // faulted back in from the file if touched again
+  static void releaseMapped(const uchar*, const uchar*);
+private:
+  QFile file;
+  uchar* map;
+  qint64 size;
+  qint64 position;
+  qint64 released; // mapped bytes before this have been dropped
+  AVIOContext* ioCtx;
+  bool onLocalFilesystem();
+  void adviseSequential();
+  static int read(void*, uint8_t*, int);
+  static int64_t seek(void*, int64_t, int);
+};
+
+#endif // LOCALFILEIO_H
@@ -26,7 +26,11 @@
 #include "guibatch.h"
 #include "guimenuhandler.h"
 #include "decoderlibav.h"
+#include "fftwwisdom.h"
 #include "asynckeyresult.h"
+#include "analysislane.h"
+#include "chromagramstore.h"
+#include "cuesheet.h"
 
 #include <fstream>
 
@@ -60,29 +64,139 @@ void LoggingHandler(QtMsgType type, const QMessageLogContext& /*context*/, const
   }
 }
 
+// keys for every chromagram in the store ("-" for the usual one), one
+// tab-separated line per unchanged file with the seconds of it analysed and
+// its duration, without decoding anything
+int reclassifyStoredChromagrams(const QString& storePath) {
+  QString path = (storePath == "-" ? ChromagramStore::storePath() : storePath);
+  ChromagramStore store(path);
+  if (store.size() == 0) {
+    std::cerr << "No stored chromagrams in " << path.toUtf8().constData() << std::endl;
+    return 1;
+  }
+  Preferences prefs;
+  KeyFinder::KeyFinder kf;
+  QMap<QString, ChromagramStore::Classification> keys = store.reclassify(kf);
+  for (QMap<QString, ChromagramStore::Classification>::const_iterator it = keys.constBegin(); it != keys.constEnd(); ++it) {
+    std::cout << it.key().toUtf8().constData() << "\t" << prefs.getKeyCode(it->key).toUtf8().constData();
+    std::cout << "\t" << it->secondsAnalysed << "\t" << it->durationSeconds << "\n";
+  }
+  return 0;
+}
+
+// a key for every audio track of a CUE sheet, one tab-separated line per
+// track, with each image decoded once
+int analyseCueSheet(const QString& cuePath, const Preferences& prefs) {
+  CueSheet cue(cuePath);
+  if (!cue.isValid()) {
+    std::cerr << "No audio tracks in " << cuePath.toUtf8().constData() << std::endl;
+    return 1;
+  }
+  QList<AsyncFileObject> images;
+  QList<int> trackNumbers;
+  foreach (const CueTrack& track, cue.getTracks()) {
+    if (images.isEmpty() || images.last().filePath != track.filePath) images.push_back(AsyncFileObject(track.filePath, prefs, 0));
+    images.last().tracks.push_back(TrackRange(track.startSeconds, track.endSeconds, trackNumbers.size()));
+    trackNumbers.push_back(track.number);
+  }
+  int failures = 0;
+  foreach (const AsyncFileObject& image, images) {
+    std::vector<KeyFinderResultWrapper> results = trackKeyDetectionProcess(image);
+    for (unsigned int t = 0; t < results.size(); t++) {
+      std::cout << trackNumbers[results[t].batchRow] << "\t";
+      if (results[t].errorMessage.isEmpty()) {
+        std::cout << prefs.getKeyCode(results[t].core).toUtf8().constData() << "\n";
+      } else {
+        std::cout << "\n";
+        std::cerr << results[t].errorMessage.toUtf8().constData() << std::endl;
+        failures++;
+      }
+    }
+  }
+  return (failures > 0 ? 1 : 0);
+}
+
 int commandLineInterface(int argc, char* argv[]) {
 
   QString filePath = "";
+  QString reclassifyStore = "";
+  QStringList configurations;
   bool writeToTags = false;
+  bool fastScan = false;
+  int timelineSeconds = 0;
 
   for (int i = 1; i < argc; i++) {
     if (std::strcmp(argv[i], "-f") == 0 && i+1 < argc)
       filePath = argv[++i];
     else if (std::strcmp(argv[i], "-w") == 0)
       writeToTags = true;
+    else if (std::strcmp(argv[i], "-s") == 0)
+      fastScan = true;
+    else if (std::strcmp(argv[i], "-t") == 0 && i+1 < argc)
+      timelineSeconds = atoi(argv[++i]);
+    else if (std::strcmp(argv[i], "-r") == 0 && i+1 < argc)
+      reclassifyStore = argv[++i];
+    else if (std::strcmp(argv[i], "-c") == 0 && i+1 < argc)
+      configurations << argv[++i];
   }
+  if (!reclassifyStore.isEmpty())
+    return reclassifyStoredChromagrams(reclassifyStore);
   if (filePath.isEmpty())
     return -1; // not a valid CLI attempt, launch GUI
 
   Preferences prefs;
+  if (fastScan)
+    prefs.setFastScan(true);
+  if (timelineSeconds > 0)
+    prefs.setKeyTimelineSeconds(timelineSeconds);
+
+  // one file per process: plan while the decoder opens the file, and keep
+  // the wisdom for later runs
+  bool warmUp = !FftwWisdom::load() && prefs.getFftwWarmUp();
+  if (warmUp)
+    FftwWisdom::startWarmUp();
+
+  if (filePath.endsWith(".cue", Qt::CaseInsensitive)) {
+    int cueResult = analyseCueSheet(filePath, prefs);
+    if (warmUp)
+      FftwWisdom::save();
+    return cueResult;
+  }
+
+  // each -c name=value,name=value... is a further set of analysis settings,
+  // tried on the same decoded audio, whose key is printed on its own line
+  // with the seconds it analysed. Only settings a lane reads can differ.
   AsyncFileObject object(filePath, prefs, 0);
+  for (int c = 0; c < configurations.size(); c++) {
+    QHash<QString, QVariant> overrides;
+    foreach (const QString& setting, configurations[c].split(',', QString::SkipEmptyParts)) {
+      QString name = setting.section('=', 0, 0);
+      if (!AnalysisLane::settingNames().contains(name)) {
+        std::cerr << name.toUtf8().constData() << " can't differ between configurations; try one of "
+                  << AnalysisLane::settingNames().join(", ").toUtf8().constData() << std::endl;
+        return 1;
+      }
+      overrides.insert(name, setting.section('=', 1));
+    }
+    object.configurations.push_back(Preferences(new SettingsWrapperOverride(overrides)));
+  }
   KeyFinderResultWrapper result = keyDetectionProcess(object);
+  if (warmUp)
+    FftwWisdom::save();
   if (!result.errorMessage.isEmpty()) {
     std::cerr << result.errorMessage.toUtf8().constData();
     return 1;
   }
 
   std::cout << prefs.getKeyCode(result.core).toUtf8().constData();
+  for (unsigned int c = 0; c < result.configurations.size(); c++) {
+    const ConfigurationResult& configuration = result.configurations[c];
+    std::cout << std::endl << prefs.getKeyCode(configuration.key).toUtf8().constData() << "\t" << configuration.secondsAnalysed;
+    if (!configuration.keyTimeline.empty())
+      std::cout << "\t" << KeyTimeline::describe(configuration.keyTimeline, prefs, "\t").toUtf8().constData();
+  }
+  if (!result.keyTimeline.empty())
+    std::cout << std::endl << KeyTimeline::describe(result.keyTimeline, prefs, "\n").toUtf8().constData();
 
   if (writeToTags) {
     AVFileMetadataFactory factory;
@@ -111,7 +225,7 @@ int main(int argc, char* argv[]) {
   // libav setup
   av_register_all();
   av_log_set_level(AV_LOG_ERROR);
-  av_lockmgr_register(NULL);
+  av_lockmgr_register(AudioFileDecoder::libavLockManager);
 
   // primitive command line use
   if (argc > 2) {
@@ -147,8 +261,16 @@ int main(int argc, char* argv[]) {
   myappTranslator.load(appTranslationPath);
   a.installTranslator(&myappTranslator);
 
+  FftwWisdom::load();
+  if (Preferences().getFftwWarmUp()) {
+    FftwWisdom::startWarmUp();
+  }
+
   MainMenuHandler* menuHandler = new MainMenuHandler(0);
   menuHandler->newBatchWindow(true);
 
-  return a.exec();
+  int result = a.exec();
+  FftwWisdom::waitForWarmUp();
+  FftwWisdom::save();
+  return result;
 }
@@ -83,6 +83,25 @@ void Preferences::copy(const Preferences &that) {
   metadataWriteFilename     = that.metadataWriteFilename;
   metadataFormat            = that.metadataFormat;
   maxDuration               = that.maxDuration;
+  decodeChunkSeconds        = that.decodeChunkSeconds;
+  decimateInDecoder         = that.decimateInDecoder;
+  fastScan                  = that.fastScan;
+  fastScanWindows           = that.fastScanWindows;
+  fastScanWindowSeconds     = that.fastScanWindowSeconds;
+  prefetchDepth             = that.prefetchDepth;
+  pipelineDecode            = that.pipelineDecode;
+  streamLongFiles           = that.streamLongFiles;
+  fftwWarmUp                = that.fftwWarmUp;
+  keyTimelineSeconds        = that.keyTimelineSeconds;
+  parallelChunkMinutes      = that.parallelChunkMinutes;
+  earlyStop                 = that.earlyStop;
+  earlyStopMargin           = that.earlyStopMargin;
+  earlyStopSeconds          = that.earlyStopSeconds;
+  resultCache               = that.resultCache;
+  resultCacheHash           = that.resultCacheHash;
+  storeChromagrams          = that.storeChromagrams;
+  silenceGate               = that.silenceGate;
+  silenceThreshold          = that.silenceThreshold;
   iTunesLibraryPath         = that.iTunesLibraryPath;
   traktorLibraryPath        = that.traktorLibraryPath;
   seratoLibraryPath         = that.seratoLibraryPath;
@@ -115,6 +134,25 @@ bool Preferences::equivalentTo(const Preferences& that) const {
   if (metadataWriteFilename     != that.metadataWriteFilename)     return false;
   if (metadataFormat            != that.metadataFormat)            return false;
   if (maxDuration               != that.maxDuration)               return false;
+  if (decodeChunkSeconds        != that.decodeChunkSeconds)        return false;
+  if (decimateInDecoder         != that.decimateInDecoder)         return false;
+  if (fastScan                  != that.fastScan)                  return false;
+  if (fastScanWindows           != that.fastScanWindows)           return false;
+  if (fastScanWindowSeconds     != that.fastScanWindowSeconds)     return false;
+  if (prefetchDepth             != that.prefetchDepth)             return false;
+  if (pipelineDecode            != that.pipelineDecode)            return false;
+  if (streamLongFiles           != that.streamLongFiles)           return false;
+  if (fftwWarmUp                != that.fftwWarmUp)                return false;
+  if (keyTimelineSeconds        != that.keyTimelineSeconds)        return false;
+  if (parallelChunkMinutes      != that.parallelChunkMinutes)      return false;
+  if (earlyStop                 != that.earlyStop)                 return false;
+  if (earlyStopMargin           != that.earlyStopMargin)           return false;
+  if (earlyStopSeconds          != that.earlyStopSeconds)          return false;
+  if (resultCache               != that.resultCache)               return false;
+  if (resultCacheHash           != that.resultCacheHash)           return false;
+  if (storeChromagrams          != that.storeChromagrams)          return false;
+  if (silenceGate               != that.silenceGate)               return false;
+  if (silenceThreshold          != that.silenceThreshold)          return false;
   if (iTunesLibraryPath         != that.iTunesLibraryPath)         return false;
   if (traktorLibraryPath        != that.traktorLibraryPath)        return false;
   if (seratoLibraryPath         != that.seratoLibraryPath)         return false;
@@ -182,6 +220,26 @@ void Preferences::load() {
   skipFilesWithExistingTags = settings->value("skipFilesWithExistingTags", false).toBool();
   applyFileExtensionFilter = settings->value("applyFileExtensionFilter", false).toBool();
   maxDuration = settings->value("maxDuration", 60).toInt();
+  // a chunk under a second would be no frames at all
+  decodeChunkSeconds = qMax(1, settings->value("decodeChunkSeconds", 5).toInt());
+  decimateInDecoder = settings->value("decimateInDecoder", false).toBool();
+  fastScan = settings->value("fastScan", false).toBool();
+  fastScanWindows = settings->value("fastScanWindows", 6).toInt();
+  fastScanWindowSeconds = settings->value("fastScanWindowSeconds", 10).toInt();
+  prefetchDepth = settings->value("prefetchDepth", 2).toInt();
+  pipelineDecode = settings->value("pipelineDecode", false).toBool();
+  streamLongFiles = settings->value("streamLongFiles", true).toBool();
+  fftwWarmUp = settings->value("fftwWarmUp", true).toBool();
+  keyTimelineSeconds = settings->value("keyTimelineSeconds", 0).toInt();
+  parallelChunkMinutes = settings->value("parallelChunkMinutes", 20).toInt();
+  earlyStop = settings->value("earlyStop", false).toBool();
+  earlyStopMargin = settings->value("earlyStopMargin", 5).toInt();
+  earlyStopSeconds = settings->value("earlyStopSeconds", 60).toInt();
+  resultCache = settings->value("resultCache", true).toBool();
+  resultCacheHash = settings->value("resultCacheHash", false).toBool();
+  storeChromagrams = settings->value("storeChromagrams", false).toBool();
+  silenceGate = settings->value("silenceGate", false).toBool();
+  silenceThreshold = settings->value("silenceThreshold", -60).toInt();
   QStringList defaultFilterFileExtensions;
   defaultFilterFileExtensions << "mp3" << "m4a" << "mp4" << "wma";
   defaultFilterFileExtensions << "flac" << "aif" << "aiff" << "wav";
@@ -252,6 +310,25 @@ void Preferences::save() {
   settings->setValue("skipFilesWithExistingTags", skipFilesWithExistingTags);
   settings->setValue("applyFileExtensionFilter", applyFileExtensionFilter);
   settings->setValue("maxDuration", maxDuration);
+  settings->setValue("decodeChunkSeconds", decodeChunkSeconds);
+  settings->setValue("decimateInDecoder", decimateInDecoder);
+  settings->setValue("fastScan", fastScan);
+  settings->setValue("fastScanWindows", fastScanWindows);
+  settings->setValue("fastScanWindowSeconds", fastScanWindowSeconds);
+  settings->setValue("prefetchDepth", prefetchDepth);
+  settings->setValue("pipelineDecode", pipelineDecode);
+  settings->setValue("streamLongFiles", streamLongFiles);
+  settings->setValue("fftwWarmUp", fftwWarmUp);
+  settings->setValue("keyTimelineSeconds", keyTimelineSeconds);
+  settings->setValue("parallelChunkMinutes", parallelChunkMinutes);
+  settings->setValue("earlyStop", earlyStop);
+  settings->setValue("earlyStopMargin", earlyStopMargin);
+  settings->setValue("earlyStopSeconds", earlyStopSeconds);
+  settings->setValue("resultCache", resultCache);
+  settings->setValue("resultCacheHash", resultCacheHash);
+  settings->setValue("storeChromagrams", storeChromagrams);
+  settings->setValue("silenceGate", silenceGate);
+  settings->setValue("silenceThreshold", silenceThreshold);
   settings->setValue("filterFileExtensions", filterFileExtensions);
   settings->endGroup();
 
@@ -282,6 +359,25 @@ metadata_write_t  Preferences::getMetadataWriteFilename()     const { return met
 metadata_format_t Preferences::getMetadataFormat()            const { return metadataFormat; }
 bool              Preferences::getSkipFilesWithExistingTags() const { return skipFilesWithExistingTags; }
 int               Preferences::getMaxDuration()               const { return maxDuration; }
+int               Preferences::getDecodeChunkSeconds()        const { return decodeChunkSeconds; }
+bool              Preferences::getDecimateInDecoder()         const { return decimateInDecoder; }
+bool              Preferences::getFastScan()                  const { return fastScan; }
+int               Preferences::getFastScanWindows()           const { return fastScanWindows; }
+int               Preferences::getFastScanWindowSeconds()     const { return fastScanWindowSeconds; }
+int               Preferences::getPrefetchDepth()             const { return prefetchDepth; }
+bool              Preferences::getPipelineDecode()            const { return pipelineDecode; }
+bool              Preferences::getStreamLongFiles()           const { return streamLongFiles; }
+bool              Preferences::getFftwWarmUp()                const { return fftwWarmUp; }
+int               Preferences::getKeyTimelineSeconds()        const { return keyTimelineSeconds; }
+int               Preferences::getParallelChunkMinutes()      const { return parallelChunkMinutes; }
+bool              Preferences::getEarlyStop()                 const { return earlyStop; }
+int               Preferences::getEarlyStopMargin()           const { return earlyStopMargin; }
+int               Preferences::getEarlyStopSeconds()          const { return earlyStopSeconds; }
+bool              Preferences::getResultCache()               const { return resultCache; }
+bool              Preferences::getResultCacheHash()           const { return resultCacheHash; }
+bool              Preferences::getStoreChromagrams()          const { return storeChromagrams; }
+bool              Preferences::getSilenceGate()               const { return silenceGate; }
+int               Preferences::getSilenceThreshold()          const { return silenceThreshold; }
 QString           Preferences::getITunesLibraryPath()         const { return iTunesLibraryPath; }
 QString           Preferences::getTraktorLibraryPath()        const { return traktorLibraryPath; }
 QString           Preferences::getSeratoLibraryPath()         const { return seratoLibraryPath; }
@@ -303,6 +399,25 @@ void Preferences::setMetadataWriteKey(metadata_write_t key)        { metadataWri
 void Preferences::setMetadataWriteFilename(metadata_write_t fn)    { metadataWriteFilename = fn; }
 void Preferences::setSkipFilesWithExistingTags(bool skip)          { skipFilesWithExistingTags = skip; }
 void Preferences::setMaxDuration(int max)                          { maxDuration = max; }
+void Preferences::setDecodeChunkSeconds(int secs)                  { decodeChunkSeconds = qMax(1, secs); }
+void Preferences::setDecimateInDecoder(bool decimate)              { decimateInDecoder = decimate; }
+void Preferences::setFastScan(bool fast)                           { fastScan = fast; }
+void Preferences::setFastScanWindows(int windows)                  { fastScanWindows = windows; }
+void Preferences::setFastScanWindowSeconds(int secs)               { fastScanWindowSeconds = secs; }
+void Preferences::setPrefetchDepth(int depth)                      { prefetchDepth = depth; }
+void Preferences::setPipelineDecode(bool pipeline)                 { pipelineDecode = pipeline; }
+void Preferences::setStreamLongFiles(bool stream)                  { streamLongFiles = stream; }
+void Preferences::setFftwWarmUp(bool warmUp)                       { fftwWarmUp = warmUp; }
+void Preferences::setKeyTimelineSeconds(int seconds)               { keyTimelineSeconds = seconds; }
+void Preferences::setParallelChunkMinutes(int minutes)             { parallelChunkMinutes = minutes; }
+void Preferences::setEarlyStop(bool stop)                          { earlyStop = stop; }
+void Preferences::setEarlyStopMargin(int margin)                   { earlyStopMargin = margin; }
+void Preferences::setEarlyStopSeconds(int seconds)                 { earlyStopSeconds = seconds; }
+void Preferences::setResultCache(bool cache)                       { resultCache = cache; }
+void Preferences::setResultCacheHash(bool hash)                    { resultCacheHash = hash; }
+void Preferences::setStoreChromagrams(bool store)                  { storeChromagrams = store; }
+void Preferences::setSilenceGate(bool gate)                        { silenceGate = gate; }
+void Preferences::setSilenceThreshold(int threshold)               { silenceThreshold = threshold; }
 void Preferences::setMetadataFormat(metadata_format_t fmt)         { metadataFormat = fmt; }
 void Preferences::setITunesLibraryPath(const QString& path)        { iTunesLibraryPath = path; }
 void Preferences::setTraktorLibraryPath(const QString& path)       { traktorLibraryPath = path; }
@@ -100,6 +100,25 @@ public:
   metadata_write_t getMetadataWriteFilename() const;
   metadata_format_t getMetadataFormat() const;
   int getMaxDuration() const;
+  int getDecodeChunkSeconds() const;
+  bool getDecimateInDecoder() const;
+  bool getFastScan() const;
+  int getFastScanWindows() const;
+  int getFastScanWindowSeconds() const;
+  int getPrefetchDepth() const;
+  bool getPipelineDecode() const;
+  bool getStreamLongFiles() const;
+  bool getFftwWarmUp() const;
+  int getKeyTimelineSeconds() const;
+  int getParallelChunkMinutes() const;
+  bool getEarlyStop() const;
+  int getEarlyStopMargin() const;
+  int getEarlyStopSeconds() const;
+  bool getResultCache() const;
+  bool getResultCacheHash() const;
+  bool getStoreChromagrams() const;
+  bool getSilenceGate() const;
+  int getSilenceThreshold() const;
   QString getITunesLibraryPath() const;
   QString getTraktorLibraryPath() const;
   QString getSeratoLibraryPath() const;
@@ -125,6 +144,25 @@ public:
   void setMetadataWriteFilename(metadata_write_t);
   void setMetadataFormat(metadata_format_t);
   void setMaxDuration(int);
+  void setDecodeChunkSeconds(int);
+  void setDecimateInDecoder(bool);
+  void setFastScan(bool);
+  void setFastScanWindows(int);
+  void setFastScanWindowSeconds(int);
+  void setPrefetchDepth(int);
+  void setPipelineDecode(bool);
+  void setStreamLongFiles(bool);
+  void setFftwWarmUp(bool);
+  void setKeyTimelineSeconds(int);
+  void setParallelChunkMinutes(int);
+  void setEarlyStop(bool);
+  void setEarlyStopMargin(int);
+  void setEarlyStopSeconds(int);
+  void setResultCache(bool);
+  void setResultCacheHash(bool);
+  void setStoreChromagrams(bool);
+  void setSilenceGate(bool);
+  void setSilenceThreshold(int);
   void setITunesLibraryPath(const QString&);
   void setTraktorLibraryPath(const QString&);
   void setSeratoLibraryPath(const QString&);
@@ -161,6 +199,25 @@ private:
   metadata_write_t metadataWriteFilename;
   metadata_format_t metadataFormat;
   int maxDuration;
+  int decodeChunkSeconds;
+  bool decimateInDecoder;
+  bool fastScan;
+  int fastScanWindows;
+  int fastScanWindowSeconds;
+  int prefetchDepth;
+  bool pipelineDecode;
+  bool streamLongFiles;
+  bool fftwWarmUp;
+  int keyTimelineSeconds;
+  int parallelChunkMinutes;
+  bool earlyStop;
+  int earlyStopMargin;
+  int earlyStopSeconds;
+  bool resultCache;
+  bool resultCacheHash;
+  bool storeChromagrams;
+  bool silenceGate;
+  int silenceThreshold;
   QString iTunesLibraryPath;
   QString traktorLibraryPath;
   QString seratoLibraryPath;
@@ -0,0 +1,230 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "resultcache.h"
+
+#include <cstring>
+
+#ifndef Q_OS_WIN
+#include <sys/stat.h>
+#endif
+
+const char* CACHE_MAGIC = "KFRC";
+const quint32 CACHE_FORMAT_VERSION = 2;
+const int CACHE_STREAM_VERSION = QDataStream::Qt_5_0;
+const int CACHE_LOCK_TIMEOUT = 5000; // ms
+
+ResultCache::ResultCache(const QString& p) : path(p), loaded(false), records(0) { }
+
+ResultCache* ResultCache::getInstance() {
+  static ResultCache instance(cachePath());
+  return &instance;
+}
+
+QString ResultCache::cachePath() {
+  return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/results.cache";
+}
+
+bool ResultCache::lookup(const QByteArray& identity, const Preferences& prefs, KeyFinderResultWrapper& result) {
+  if (identity.isEmpty()) return false;
+  QMutexLocker locker(&mutex);
+  load();
+  QHash<QByteArray, Entry>::const_iterator it = entries.constFind(identity);
+  if (it == entries.constEnd() || it->fingerprint != fingerprint(prefs)) return false;
+  result.core = it->key;
+  result.secondsAnalysed = it->secondsAnalysed;
+  result.durationSeconds = it->durationSeconds;
+  result.samplesSkipped = it->samplesSkipped;
+  result.keyTimeline = it->keyTimeline;
+  return true;
+}
+
+void ResultCache::store(const QByteArray& identity, const Preferences& prefs, const KeyFinderResultWrapper& result) {
+  if (identity.isEmpty()) return;
+  Entry entry;
+  entry.fingerprint = fingerprint(prefs);
+  entry.key = result.core;
+  entry.secondsAnalysed = result.secondsAnalysed;
+  entry.durationSeconds = result.durationSeconds;
+  entry.samplesSkipped = result.samplesSkipped;
+  entry.keyTimeline = result.keyTimeline;
+
+  QMutexLocker locker(&mutex);
+  load();
+  entries.insert(identity, entry);
+  QLockFile lock(path + ".lock");
+  if (!lock.tryLock(CACHE_LOCK_TIMEOUT)) {
+    qWarning("Result cache %s is locked, not writing to it", path.toLocal8Bit().constData());
+    return;
+  }
+  QFile file(path);
+  if (!file.open(QIODevice::Append)) {
+    qWarning("Could not write to result cache %s", path.toLocal8Bit().constData());
+    return;
+  }
+  QDataStream out(&file);
+  out.setVersion(CACHE_STREAM_VERSION);
+  if (file.size() == 0) {
+    out.writeRawData(CACHE_MAGIC, 4);
+    out << CACHE_FORMAT_VERSION;
+  }
+  writeRecord(out, identity, entry);
+  file.close();
+  records++;
+  if (records > 2 * (unsigned int) entries.size() + 1024) compact();
+}
+
+unsigned int ResultCache::size() {
+  QMutexLocker locker(&mutex);
+  load();
+  return entries.size();
+}
+
+QByteArray ResultCache::fileIdentity(const QString& filePath, bool hashContents) {
+  QFileInfo info(filePath);
+  QString canonical = info.canonicalFilePath();
+  if (canonical.isEmpty()) return QByteArray();
+  QByteArray identity;
+  QDataStream out(&identity, QIODevice::WriteOnly);
+  out.setVersion(CACHE_STREAM_VERSION);
+  out << canonical << (qint64) info.size() << (qint64) info.lastModified().toMSecsSinceEpoch();
+#ifndef Q_OS_WIN
+  struct stat st;
+  if (stat(QFile::encodeName(canonical).constData(), &st) == 0) {
+    out << (quint64) st.st_ino;
+  }
+#endif
+  if (hashContents) {
+    QFile file(canonical);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(&file);
+    out << hash.result();
+  }
+  return identity;
+}
+
+QByteArray ResultCache::fingerprint(const Preferences& prefs) {
+  QByteArray settings;
+  QDataStream out(&settings, QIODevice::WriteOnly);
+  out.setVersion(CACHE_STREAM_VERSION);
+  out << CACHE_FORMAT_VERSION << VERSION_MAJOR << VERSION_MINOR;
+  out << prefs.getMaxDuration() << prefs.getStreamLongFiles() << prefs.getDecimateInDecoder() << prefs.getDecodeChunkSeconds();
+  out << prefs.getFastScan() << prefs.getFastScanWindows() << prefs.getFastScanWindowSeconds();
+  out << prefs.getKeyTimelineSeconds() << prefs.getParallelChunkMinutes();
+  out << prefs.getEarlyStop() << prefs.getEarlyStopMargin() << prefs.getEarlyStopSeconds();
+  out << prefs.getSilenceGate() << prefs.getSilenceThreshold();
+  return QCryptographicHash::hash(settings, QCryptographicHash::Sha1);
+}
+
+void ResultCache::load() {
+  if (loaded) return;
+  QDir().mkpath(QFileInfo(path).absolutePath());
+  QLockFile lock(path + ".lock");
+  if (!lock.tryLock(CACHE_LOCK_TIMEOUT)) return; // everything misses until it can be read
+  loaded = true;
+  records = readLog(entries);
+}
+
+unsigned int ResultCache::readLog(QHash<QByteArray, Entry>& into) const {
+  QFile file(path);
+  if (!file.open(QIODevice::ReadOnly)) return 0;
+  QDataStream in(&file);
+  in.setVersion(CACHE_STREAM_VERSION);
+  char magic[4];
+  quint32 version = 0;
+  bool header = in.readRawData(magic, 4) == 4 && memcmp(magic, CACHE_MAGIC, 4) == 0;
+  if (header) in >> version;
+  if (!header || version != CACHE_FORMAT_VERSION) {
+    // not ours, or written by another version; start again rather than
+    // append to it
+    file.close();
+    QFile::remove(path);
+    return 0;
+  }
+  QByteArray identity;
+  Entry entry;
+  unsigned int count = 0;
+  qint64 goodEnd = file.pos();
+  while (!in.atEnd() && readRecord(in, identity, entry)) {
+    into.insert(identity, entry);
+    count++;
+    goodEnd = file.pos();
+  }
+  // a record cut short by a crash ends the log, and is dropped; the log is
+  // cut back to the last whole record so later ones aren't appended after it
+  qint64 size = file.size();
+  file.close();
+  if (goodEnd < size) {
+    qWarning("Dropping %lld bytes of incomplete record from result cache %s", size - goodEnd, path.toLocal8Bit().constData());
+    if (!QFile::resize(path, goodEnd)) QFile::remove(path);
+  }
+  return count;
+}
+
+void ResultCache::compact() {
+  // other processes may have appended since the log was read, so it's read
+  // again and their records kept; ours are in it too, and where both have
+  // one for a file, the later record in the log wins as it would on load
+  QHash<QByteArray, Entry> merged;
+  readLog(merged);
+  for (QHash<QByteArray, Entry>::const_iterator it = entries.constBegin(); it != entries.constEnd(); ++it) {
+    if (!merged.contains(it.key())) merged.insert(it.key(), it.value());
+  }
+  entries = merged;
+  QFile file(path + ".new");
+  if (!file.open(QIODevice::WriteOnly)) return;
+  QDataStream out(&file);
+  out.setVersion(CACHE_STREAM_VERSION);
+  out.writeRawData(CACHE_MAGIC, 4);
+  out << CACHE_FORMAT_VERSION;
+  for (QHash<QByteArray, Entry>::const_iterator it = entries.constBegin(); it != entries.constEnd(); ++it) {
+    writeRecord(out, it.key(), it.value());
+  }
+  file.close();
+  QFile::remove(path);
+  if (QFile::rename(path + ".new", path)) records = entries.size();
+}
+
+void ResultCache::writeRecord(QDataStream& out, const QByteArray& identity, const Entry& entry) {
+  out << identity << entry.fingerprint << (qint32) entry.key << entry.secondsAnalysed << entry.durationSeconds << entry.samplesSkipped;
+  out << (quint32) entry.keyTimeline.size();
+  for (unsigned int i = 0; i < entry.keyTimeline.size(); i++) {
+    out << entry.keyTimeline[i].startSeconds << entry.keyTimeline[i].endSeconds << (qint32) entry.keyTimeline[i].key;
+  }
+}
+
+bool ResultCache::readRecord(QDataStream& in, QByteArray& identity, Entry& entry) {
+  qint32 key;
+  quint32 segments;
+  in >> identity >> entry.fingerprint >> key >> entry.secondsAnalysed >> entry.durationSeconds >> entry.samplesSkipped >> segments;
+  if (in.status() != QDataStream::Ok) return false;
+  entry.key = (KeyFinder::key_t) key;
+  entry.keyTimeline.clear();
+  for (quint32 i = 0; i < segments; i++) {
+    double start, end;
+    qint32 segmentKey;
+    in >> start >> end >> segmentKey;
+    if (in.status() != QDataStream::Ok) return false;
+    entry.keyTimeline.push_back(KeySegment(start, end, (KeyFinder::key_t) segmentKey));
+  }
+  return true;
+}
@@ -0,0 +1,97 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#ifndef RESULTCACHE_H
+#define RESULTCACHE_H
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QLockFile>
+#include <QMutex>
+#include <QStandardPaths>
+#include <QString>
+
+#include <vector>
+
+#include "preferences.h"
+#include "asynckeyresult.h"
+#include "_VERSION.h"
+
+/*
+
+Remembers analysis results between runs, so a file that hasn't changed
+since it was last analysed with the same settings needn't be decoded again.
+Files are identified by canonical path, size, modification time and inode,
+plus, optionally, a hash of their contents. Each result is stored with a
+fingerprint of the settings that shape analysis and of the app version; an
+entry whose fingerprint doesn't match is a miss, so changing those settings
+invalidates the cache without anything having to be cleared.
+
+Entries are held in memory and appended to a log on disk as they're added;
+the log is read once, on first use, with later records for a file
+replacing earlier ones. It's rewritten without the replaced records when
+they come to outnumber the live ones, keeping any that other processes
+have appended meanwhile. Reading, appending and rewriting all hold a lock
+file beside the log, so concurrent runs of the app can share it.
+
+*/
+
+class ResultCache {
+public:
+  ResultCache(const QString& path);
+  static ResultCache* getInstance();
+  static QString cachePath();
+  // empty if the file can't be found; worked out once per file, since
+  // hashing the contents reads it all
+  static QByteArray fileIdentity(const QString& filePath, bool hashContents);
+  // fills in the result if there's an entry for the file as it is now
+  bool lookup(const QByteArray& identity, const Preferences&, KeyFinderResultWrapper&);
+  void store(const QByteArray& identity, const Preferences&, const KeyFinderResultWrapper&);
+  unsigned int size();
+  static QByteArray fingerprint(const Preferences&);
+private:
+  class Entry {
+  public:
+    QByteArray fingerprint;
+    KeyFinder::key_t key;
+    double secondsAnalysed;
+    double durationSeconds;
+    quint64 samplesSkipped;
+    std::vector<KeySegment> keyTimeline;
+  };
+  void load();
+  unsigned int readLog(QHash<QByteArray, Entry>&) const;
+  void compact(); // with the lock held
+  static void writeRecord(QDataStream&, const QByteArray&, const Entry&);
+  static bool readRecord(QDataStream&, QByteArray&, Entry&);
+  QString path;
+  QMutex mutex;
+  bool loaded;
+  unsigned int records;
+  QHash<QByteArray, Entry> entries;
+};
+
+#endif // RESULTCACHE_H
@@ -0,0 +1,362 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#include "sampleconversion.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SAMPLECONVERSION_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+// ============================ Scalar kernels =================================
+
+template <typename T> static inline double scaled(T);
+template <> inline double scaled<uint8_t>(uint8_t s) { return (s - 128) * 256.0; }
+template <> inline double scaled<int16_t>(int16_t s) { return s; }
+template <> inline double scaled<int32_t>(int32_t s) { return s * (1.0 / 65536.0); }
+template <> inline double scaled<float>(float s)     { return s * 32768.0; }
+template <> inline double scaled<double>(double s)   { return s * 32768.0; }
+
+// CH is the channel count when known at compile time, 0 otherwise
+
+template <typename T, int CH>
+static void packedToInterleaved(const uint8_t* const* planes, int channels, int frames, double* out) {
+  const T* in = reinterpret_cast<const T*>(planes[0]);
+  int n = frames * (CH > 0 ? CH : channels);
+  for (int i = 0; i < n; i++) {
+    out[i] = scaled<T>(in[i]);
+  }
+}
+
+template <typename T, int CH>
+static void planarToInterleaved(const uint8_t* const* planes, int channels, int frames, double* out) {
+  int ch = (CH > 0 ? CH : channels);
+  for (int c = 0; c < ch; c++) {
+    const T* in = reinterpret_cast<const T*>(planes[c]);
+    for (int i = 0; i < frames; i++) {
+      out[i * ch + c] = scaled<T>(in[i]);
+    }
+  }
+}
+
+template <typename T, int CH>
+static void packedDownmix(const uint8_t* const* planes, int channels, int frames, double* out) {
+  const T* in = reinterpret_cast<const T*>(planes[0]);
+  int ch = (CH > 0 ? CH : channels);
+  double norm = 1.0 / ch;
+  for (int i = 0; i < frames; i++) {
+    double sum = 0.0;
+    for (int c = 0; c < ch; c++) {
+      sum += scaled<T>(in[i * ch + c]);
+    }
+    out[i] = sum * norm;
+  }
+}
+
+template <typename T, int CH>
+static void planarDownmix(const uint8_t* const* planes, int channels, int frames, double* out) {
+  int ch = (CH > 0 ? CH : channels);
+  double norm = 1.0 / ch;
+  const T* first = reinterpret_cast<const T*>(planes[0]);
+  for (int i = 0; i < frames; i++) {
+    out[i] = scaled<T>(first[i]);
+  }
+  for (int c = 1; c < ch; c++) {
+    const T* in = reinterpret_cast<const T*>(planes[c]);
+    for (int i = 0; i < frames; i++) {
+      out[i] += scaled<T>(in[i]);
+    }
+  }
+  for (int i = 0; i < frames; i++) {
+    out[i] *= norm;
+  }
+}
+
+// ============================== SSE2 kernels =================================
+
+#ifdef SAMPLECONVERSION_X86
+
+static void s16PackedSse2(const uint8_t* const* planes, int channels, int frames, double* out) {
+  const int16_t* in = reinterpret_cast<const int16_t*>(planes[0]);
+  int n = frames * channels;
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+    __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+    _mm_storeu_pd(out + i,     _mm_cvtepi32_pd(lo));
+    _mm_storeu_pd(out + i + 2, _mm_cvtepi32_pd(_mm_shuffle_epi32(lo, 0xEE)));
+    _mm_storeu_pd(out + i + 4, _mm_cvtepi32_pd(hi));
+    _mm_storeu_pd(out + i + 6, _mm_cvtepi32_pd(_mm_shuffle_epi32(hi, 0xEE)));
+  }
+  for (; i < n; i++) {
+    out[i] = scaled<int16_t>(in[i]);
+  }
+}
+
+static void s32PackedSse2(const uint8_t* const* planes, int channels, int frames, double* out) {
+  const int32_t* in = reinterpret_cast<const int32_t*>(planes[0]);
+  int n = frames * channels;
+  __m128d scale = _mm_set1_pd(1.0 / 65536.0);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    _mm_storeu_pd(out + i,     _mm_mul_pd(_mm_cvtepi32_pd(x), scale));
+    _mm_storeu_pd(out + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(x, 0xEE)), scale));
+  }
+  for (; i < n; i++) {
+    out[i] = scaled<int32_t>(in[i]);
+  }
+}
+
+static void fltPackedSse2(const uint8_t* const* planes, int channels, int frames, double* out) {
+  const float* in = reinterpret_cast<const float*>(planes[0]);
+  int n = frames * channels;
+  __m128d scale = _mm_set1_pd(32768.0);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128 x = _mm_loadu_ps(in + i);
+    _mm_storeu_pd(out + i,     _mm_mul_pd(_mm_cvtps_pd(x), scale));
+    _mm_storeu_pd(out + i + 2, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(x, x)), scale));
+  }
+  for (; i < n; i++) {
+    out[i] = scaled<float>(in[i]);
+  }
+}
+
+static void fltPlanarStereoSse2(const uint8_t* const* planes, int /*channels*/, int frames, double* out) {
+  const float* left = reinterpret_cast<const float*>(planes[0]);
+  const float* right = reinterpret_cast<const float*>(planes[1]);
+  __m128d scale = _mm_set1_pd(32768.0);
+  int i = 0;
+  for (; i + 4 <= frames; i += 4) {
+    __m128 l = _mm_loadu_ps(left + i);
+    __m128 r = _mm_loadu_ps(right + i);
+    __m128d l0 = _mm_mul_pd(_mm_cvtps_pd(l), scale);
+    __m128d r0 = _mm_mul_pd(_mm_cvtps_pd(r), scale);
+    __m128d l1 = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(l, l)), scale);
+    __m128d r1 = _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(r, r)), scale);
+    _mm_storeu_pd(out + i * 2,     _mm_unpacklo_pd(l0, r0));
+    _mm_storeu_pd(out + i * 2 + 2, _mm_unpackhi_pd(l0, r0));
+    _mm_storeu_pd(out + i * 2 + 4, _mm_unpacklo_pd(l1, r1));
+    _mm_storeu_pd(out + i * 2 + 6, _mm_unpackhi_pd(l1, r1));
+  }
+  for (; i < frames; i++) {
+    out[i * 2]     = scaled<float>(left[i]);
+    out[i * 2 + 1] = scaled<float>(right[i]);
+  }
+}
+
+static void s16PackedStereoDownmixSse2(const uint8_t* const* planes, int /*channels*/, int frames, double* out) {
+  const int16_t* in = reinterpret_cast<const int16_t*>(planes[0]);
+  __m128i ones = _mm_set1_epi16(1);
+  __m128d half = _mm_set1_pd(0.5);
+  int i = 0;
+  for (; i + 4 <= frames; i += 4) {
+    // madd sums each adjacent L/R pair into 32 bits
+    __m128i sums = _mm_madd_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i * 2)), ones);
+    _mm_storeu_pd(out + i,     _mm_mul_pd(_mm_cvtepi32_pd(sums), half));
+    _mm_storeu_pd(out + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(sums, 0xEE)), half));
+  }
+  for (; i < frames; i++) {
+    out[i] = (in[i * 2] + in[i * 2 + 1]) * 0.5;
+  }
+}
+
+static void fltPackedStereoDownmixSse2(const uint8_t* const* planes, int /*channels*/, int frames, double* out) {
+  const float* in = reinterpret_cast<const float*>(planes[0]);
+  __m128d scale = _mm_set1_pd(0.5 * 32768.0);
+  int i = 0;
+  for (; i + 4 <= frames; i += 4) {
+    __m128 a = _mm_loadu_ps(in + i * 2);
+    __m128 b = _mm_loadu_ps(in + i * 2 + 4);
+    __m128 sums = _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    _mm_storeu_pd(out + i,     _mm_mul_pd(_mm_cvtps_pd(sums), scale));
+    _mm_storeu_pd(out + i + 2, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(sums, sums)), scale));
+  }
+  for (; i < frames; i++) {
+    out[i] = (in[i * 2] + in[i * 2 + 1]) * 0.5 * 32768.0;
+  }
+}
+
+static void fltPlanarStereoDownmixSse2(const uint8_t* const* planes, int /*channels*/, int frames, double* out) {
+  const float* left = reinterpret_cast<const float*>(planes[0]);
+  const float* right = reinterpret_cast<const float*>(planes[1]);
+  __m128d scale = _mm_set1_pd(0.5 * 32768.0);
+  int i = 0;
+  for (; i + 4 <= frames; i += 4) {
+    __m128 sums = _mm_add_ps(_mm_loadu_ps(left + i), _mm_loadu_ps(right + i));
+    _mm_storeu_pd(out + i,     _mm_mul_pd(_mm_cvtps_pd(sums), scale));
+    _mm_storeu_pd(out + i + 2, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(sums, sums)), scale));
+  }
+  for (; i < frames; i++) {
+    out[i] = (left[i] + right[i]) * 0.5 * 32768.0;
+  }
+}
+
+// ============================== AVX2 kernels =================================
+
+TARGET_AVX2 static void s16PackedAvx2(const uint8_t* const* planes, int channels, int frames, double* out) {
+  const int16_t* in = reinterpret_cast<const int16_t*>(planes[0]);
+  int n = frames * channels;
+  int i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    _mm256_storeu_pd(out + i,     _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(x)));
+    _mm256_storeu_pd(out + i + 4, _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(_mm_srli_si128(x, 8))));
+  }
+  for (; i < n; i++) {
+    out[i] = scaled<int16_t>(in[i]);
+  }
+}
+
+TARGET_AVX2 static void s32PackedAvx2(const uint8_t* const* planes, int channels, int frames, double* out) {
+  const int32_t* in = reinterpret_cast<const int32_t*>(planes[0]);
+  int n = frames * channels;
+  __m256d scale = _mm256_set1_pd(1.0 / 65536.0);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_cvtepi32_pd(x), scale));
+  }
+  for (; i < n; i++) {
+    out[i] = scaled<int32_t>(in[i]);
+  }
+}
+
+TARGET_AVX2 static void fltPackedAvx2(const uint8_t* const* planes, int channels, int frames, double* out) {
+  const float* in = reinterpret_cast<const float*>(planes[0]);
+  int n = frames * channels;
+  __m256d scale = _mm256_set1_pd(32768.0);
+  int i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm256_storeu_pd(out + i, _mm256_mul_pd(_mm256_cvtps_pd(_mm_loadu_ps(in + i)), scale));
+  }
+  for (; i < n; i++) {
+    out[i] = scaled<float>(in[i]);
+  }
+}
+
+#endif // SAMPLECONVERSION_X86
+
+// ================================ Dispatch ===================================
+
+bool SampleConversion::cpuHasAvx2() {
+#if defined(SAMPLECONVERSION_X86) && (defined(__GNUC__) || defined(__clang__))
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  return avx2;
+#else
+  return false;
+#endif
+}
+
+bool SampleConversion::formatSupported(AVSampleFormat format) {
+  switch (av_get_packed_sample_fmt(format)) {
+  case AV_SAMPLE_FMT_U8:
+  case AV_SAMPLE_FMT_S16:
+  case AV_SAMPLE_FMT_S32:
+  case AV_SAMPLE_FMT_FLT:
+  case AV_SAMPLE_FMT_DBL:
+    return true;
+  default:
+    return false;
+  }
+}
+
+template <typename T>
+static sample_kernel_t genericInterleaved(bool planar, int channels) {
+  if (!planar) return packedToInterleaved<T, 0>;
+  if (channels == 2) return planarToInterleaved<T, 2>;
+  return planarToInterleaved<T, 0>;
+}
+
+template <typename T>
+static sample_kernel_t genericDownmix(bool planar, int channels) {
+  if (channels == 1) return packedToInterleaved<T, 1>;
+  if (planar) {
+    if (channels == 2) return planarDownmix<T, 2>;
+    return planarDownmix<T, 0>;
+  }
+  if (channels == 2) return packedDownmix<T, 2>;
+  return packedDownmix<T, 0>;
+}
+
+sample_kernel_t SampleConversion::interleavedKernel(AVSampleFormat format, int channels) {
+  // a single plane is laid out the same whether it's nominally planar or not
+  bool planar = av_sample_fmt_is_planar(format) && channels > 1;
+  switch (av_get_packed_sample_fmt(format)) {
+  case AV_SAMPLE_FMT_U8:
+    return genericInterleaved<uint8_t>(planar, channels);
+  case AV_SAMPLE_FMT_S16:
+#ifdef SAMPLECONVERSION_X86
+    if (!planar) return (cpuHasAvx2() ? s16PackedAvx2 : s16PackedSse2);
+#endif
+    return genericInterleaved<int16_t>(planar, channels);
+  case AV_SAMPLE_FMT_S32:
+#ifdef SAMPLECONVERSION_X86
+    if (!planar) return (cpuHasAvx2() ? s32PackedAvx2 : s32PackedSse2);
+#endif
+    return genericInterleaved<int32_t>(planar, channels);
+  case AV_SAMPLE_FMT_FLT:
+#ifdef SAMPLECONVERSION_X86
+    if (!planar) return (cpuHasAvx2() ? fltPackedAvx2 : fltPackedSse2);
+    if (channels == 2) return fltPlanarStereoSse2;
+#endif
+    return genericInterleaved<float>(planar, channels);
+  case AV_SAMPLE_FMT_DBL:
+    return genericInterleaved<double>(planar, channels);
+  default:
+    return NULL;
+  }
+}
+
+sample_kernel_t SampleConversion::downmixKernel(AVSampleFormat format, int channels) {
+  if (channels == 1) return interleavedKernel(format, channels);
+  bool planar = av_sample_fmt_is_planar(format);
+  switch (av_get_packed_sample_fmt(format)) {
+  case AV_SAMPLE_FMT_U8:
+    return genericDownmix<uint8_t>(planar, channels);
+  case AV_SAMPLE_FMT_S16:
+#ifdef SAMPLECONVERSION_X86
+    if (!planar && channels == 2) return s16PackedStereoDownmixSse2;
+#endif
+    return genericDownmix<int16_t>(planar, channels);
+  case AV_SAMPLE_FMT_S32:
+    return genericDownmix<int32_t>(planar, channels);
+  case AV_SAMPLE_FMT_FLT:
+#ifdef SAMPLECONVERSION_X86
+    if (channels == 2) return (planar ? fltPlanarStereoDownmixSse2 : fltPackedStereoDownmixSse2);
+#endif
+    return genericDownmix<float>(planar, channels);
+  case AV_SAMPLE_FMT_DBL:
+    return genericDownmix<double>(planar, channels);
+  default:
+    return NULL;
+  }
+}
@@ -0,0 +1,54 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#ifndef SAMPLECONVERSION_H
+#define SAMPLECONVERSION_H
+
+#include <stdint.h>
+
+extern "C"{
+#include <libavutil/samplefmt.h>
+}
+
+/*
+
+Bulk conversion of decoded audio to doubles, scaled to the range of 16-bit
+samples. There's a kernel per sample format and channel layout, chosen once
+per frame; the common layouts have SSE2 and AVX2 versions, picked at runtime
+according to what the CPU supports.
+
+*/
+
+// planes, channels, frames, output
+typedef void (*sample_kernel_t)(const uint8_t* const*, int, int, double*);
+
+class SampleConversion {
+public:
+  // channels * frames interleaved samples
+  static sample_kernel_t interleavedKernel(AVSampleFormat, int);
+  // frames mono samples, averaged across channels
+  static sample_kernel_t downmixKernel(AVSampleFormat, int);
+  static bool formatSupported(AVSampleFormat);
+  static bool cpuHasAvx2();
+};
+
+#endif // SAMPLECONVERSION_H
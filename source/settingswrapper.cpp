@@ -21,3 +21,9 @@ void SettingsWrapperQt::setValue(const QString &key, const QVariant &value) {
 QStringList SettingsWrapperQt::allKeys() const {
   return priv.allKeys();
 }
+
+SettingsWrapperOverride::SettingsWrapperOverride(const QHash<QString, QVariant>& o) : overrides(o) { }
+
+QVariant SettingsWrapperOverride::value(const QString &key, const QVariant &defaultValue) const {
+  return (overrides.contains(key) ? overrides[key] : SettingsWrapperQt::value(key, defaultValue));
+}
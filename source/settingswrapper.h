@@ -24,6 +24,7 @@
 
 #include <QSettings>
 #include <QStringList>
+#include <QHash>
 
 class SettingsWrapper {
 public:
@@ -46,4 +47,13 @@ private:
   QSettings priv;
 };
 
+// the stored settings, with some values replaced, e.g. from the command line
+class SettingsWrapperOverride : public SettingsWrapperQt {
+public:
+  SettingsWrapperOverride(const QHash<QString, QVariant>& overrides);
+  virtual QVariant value(const QString &key, const QVariant &defaultValue) const;
+private:
+  QHash<QString, QVariant> overrides;
+};
+
 #endif // SETTINGSWRAPPER_H
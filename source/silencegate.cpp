@@ -0,0 +1,117 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "silencegate.h"
+
+#include <math.h>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SILENCEGATE_X86
+#include <emmintrin.h>
+#endif
+
+SilenceGate::SilenceGate(double thresholdDecibels) : samplesSkipped(0), keptAny(false), lastBlockSilent(false) {
+  double level = 32768.0 * pow(10.0, thresholdDecibels / 20.0);
+  threshold = level * level;
+}
+
+unsigned int SilenceGate::apply(KeyFinder::AudioData& chunk) {
+  unsigned int channels = chunk.getChannels();
+  unsigned int frames = chunk.getFrameCount();
+  unsigned int sampleCount = frames * channels;
+  if (sampleCount == 0) return 0;
+
+  // AudioData doesn't promise contiguous storage, so one pass to get some.
+  // This copy, and the one back, cost more than judging the blocks does.
+  samples.resize(sampleCount);
+  chunk.resetIterators();
+  for (unsigned int i = 0; i < sampleCount; i++) {
+    samples[i] = chunk.getSampleAtReadIterator();
+    chunk.advanceReadIterator();
+  }
+
+  unsigned int blockSamples = std::max(1u, (unsigned int) (chunk.getFrameRate() * SILENCE_BLOCK_SECONDS)) * channels;
+  unsigned int blocks = (sampleCount + blockSamples - 1) / blockSamples;
+  silent.resize(blocks);
+  for (unsigned int b = 0; b < blocks; b++) {
+    unsigned int start = b * blockSamples;
+    unsigned int length = std::min(blockSamples, sampleCount - start);
+    silent[b] = energy(&samples[start], length) < threshold * length;
+  }
+
+  // close up the kept blocks in place. Until something's kept, silence can
+  // simply go; after that, a silent block only goes if the blocks either
+  // side of it are silent too, so the audio is only ever joined between two
+  // quiet blocks. The last block's successor is in the next chunk, so it
+  // stays if silent.
+  unsigned int kept = 0;
+  for (unsigned int b = 0; b < blocks; b++) {
+    unsigned int start = b * blockSamples;
+    unsigned int length = std::min(blockSamples, sampleCount - start);
+    bool previousSilent = (b == 0 ? lastBlockSilent : silent[b - 1]);
+    bool nextSilent = (b + 1 < blocks && silent[b + 1]);
+    if (silent[b] && (!keptAny || (previousSilent && nextSilent))) continue;
+    if (kept != start) memmove(&samples[kept], &samples[start], length * sizeof(double));
+    kept += length;
+    keptAny = true;
+  }
+  lastBlockSilent = silent[blocks - 1];
+  if (kept == sampleCount) return 0;
+
+  unsigned int dropped = (sampleCount - kept) / channels;
+  chunk.discardFramesFromFront(dropped);
+  chunk.resetIterators();
+  for (unsigned int i = 0; i < kept; i++) {
+    chunk.setSampleAtWriteIterator(samples[i]);
+    chunk.advanceWriteIterator();
+  }
+  samplesSkipped += sampleCount - kept;
+  return dropped;
+}
+
+quint64 SilenceGate::getSamplesSkipped() const {
+  return samplesSkipped;
+}
+
+double SilenceGate::energy(const double* samples, unsigned int n) {
+  double sum = 0.0;
+  unsigned int i = 0;
+#ifdef SILENCEGATE_X86
+  // two accumulators to keep the adds from waiting on each other
+  __m128d a = _mm_setzero_pd();
+  __m128d b = _mm_setzero_pd();
+  for (; i + 4 <= n; i += 4) {
+    __m128d x = _mm_loadu_pd(samples + i);
+    __m128d y = _mm_loadu_pd(samples + i + 2);
+    a = _mm_add_pd(a, _mm_mul_pd(x, x));
+    b = _mm_add_pd(b, _mm_mul_pd(y, y));
+  }
+  double lanes[2];
+  _mm_storeu_pd(lanes, _mm_add_pd(a, b));
+  sum = lanes[0] + lanes[1];
+#endif
+  for (; i < n; i++) {
+    sum += samples[i] * samples[i];
+  }
+  return sum;
+}
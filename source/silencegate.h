@@ -0,0 +1,69 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#ifndef SILENCEGATE_H
+#define SILENCEGATE_H
+
+#include <QtGlobal>
+#include <vector>
+
+#include "keyfinder/audiodata.h"
+
+/*
+
+Takes silent stretches out of decoded chunks before they reach the
+chromagram, where they'd cost a transform per hop and water down the key
+estimate with nothing. A chunk is judged in short blocks by their mean
+energy across all channels, and silent blocks are dropped and the rest
+closed up. Joining audio either side of a gap would put a step into it, so
+after the first audible block the first and last blocks of a silent run
+stay and only what's between them goes.
+
+The blocks are judged on a copy of the chunk, since AudioData can't be read
+in place, and that copy and the one back take most of the gate's time; the
+energy sum itself is cheap.
+
+*/
+
+// the length of audio judged silent or not as a whole
+const double SILENCE_BLOCK_SECONDS = 0.1;
+
+class SilenceGate {
+public:
+  // threshold in dB relative to full scale, which for decoded samples is
+  // the 16-bit range
+  SilenceGate(double thresholdDecibels);
+  // drops the chunk's silent blocks that can go, which before anything's
+  // been kept is all of them; returns the number of frames dropped
+  unsigned int apply(KeyFinder::AudioData&);
+  quint64 getSamplesSkipped() const;
+  // sum of squares
+  static double energy(const double*, unsigned int);
+private:
+  double threshold; // mean square
+  quint64 samplesSkipped;
+  bool keptAny;
+  bool lastBlockSilent; // of the previous chunk
+  std::vector<double> samples;
+  std::vector<bool> silent;
+};
+
+#endif // SILENCEGATE_H
@@ -21,41 +21,78 @@
 
 HEADERS  += \
   $$PWD/_VERSION.h \
+  $$PWD/analysiscontext.h \
+  $$PWD/analysislane.h \
+  $$PWD/analysisresultqueue.h \
   $$PWD/asyncfileobject.h \
   $$PWD/asynckeyprocess.h \
   $$PWD/asynckeyresult.h \
   $$PWD/asyncmetadatareadprocess.h \
   $$PWD/asyncmetadatareadresult.h \
+  $$PWD/audiodecoder.h \
+  $$PWD/audiodecoderfactory.h \
   $$PWD/avfilemetadata.h \
   $$PWD/avfilemetadatafactory.h \
+  $$PWD/chromagramaccumulator.h \
+  $$PWD/chromagramstore.h \
+  $$PWD/cuesheet.h \
+  $$PWD/decimator.h \
   $$PWD/decoderlibav.h \
+  $$PWD/decoderpcm.h \
   $$PWD/externalplaylistprovider.h \
   $$PWD/externalplaylistproviderserato.h \
+  $$PWD/fftwwisdom.h \
+  $$PWD/fileprefetcher.h \
   $$PWD/guiabout.h \
   $$PWD/guibatch.h \
   $$PWD/guimenuhandler.h \
   $$PWD/guiprefs.h \
+  $$PWD/keyconvergence.h \
+  $$PWD/keytimeline.h \
+  $$PWD/localfileio.h \
   $$PWD/metadatafilename.h \
   $$PWD/metadatawriteresult.h \
   $$PWD/os_windows.h \
   $$PWD/preferences.h \
+  $$PWD/resultcache.h \
+  $$PWD/sampleconversion.h \
   $$PWD/settingswrapper.h \
+  $$PWD/silencegate.h \
+  $$PWD/spscringbuffer.h \
   $$PWD/strings.h
 
 SOURCES += \
+  $$PWD/analysiscontext.cpp \
+  $$PWD/analysislane.cpp \
+  $$PWD/analysisresultqueue.cpp \
   $$PWD/asynckeyprocess.cpp \
   $$PWD/asyncmetadatareadprocess.cpp \
+  $$PWD/audiodecoder.cpp \
+  $$PWD/audiodecoderfactory.cpp \
   $$PWD/avfilemetadata.cpp \
   $$PWD/avfilemetadatafactory.cpp \
+  $$PWD/chromagramaccumulator.cpp \
+  $$PWD/chromagramstore.cpp \
+  $$PWD/cuesheet.cpp \
+  $$PWD/decimator.cpp \
   $$PWD/decoderlibav.cpp \
+  $$PWD/decoderpcm.cpp \
   $$PWD/externalplaylistprovider.cpp \
   $$PWD/externalplaylistproviderserato.cpp \
+  $$PWD/fftwwisdom.cpp \
+  $$PWD/fileprefetcher.cpp \
   $$PWD/guiabout.cpp \
   $$PWD/guibatch.cpp \
   $$PWD/guimenuhandler.cpp \
   $$PWD/guiprefs.cpp \
+  $$PWD/keyconvergence.cpp \
+  $$PWD/keytimeline.cpp \
+  $$PWD/localfileio.cpp \
   $$PWD/metadatafilename.cpp \
   $$PWD/os_windows.cpp \
   $$PWD/preferences.cpp \
+  $$PWD/resultcache.cpp \
+  $$PWD/sampleconversion.cpp \
   $$PWD/settingswrapper.cpp \
+  $$PWD/silencegate.cpp \
   $$PWD/strings.cpp
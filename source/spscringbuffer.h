@@ -0,0 +1,114 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+#include <atomic>
+#include <vector>
+
+#include <QThread>
+
+/*
+
+A fixed ring of reusable slots passed from exactly one producer thread to
+exactly one consumer thread, without locks. The producer fills the slot it's
+given and publishes it; the consumer works on the slot it's given and
+releases it back. Either side waits (spinning briefly, then sleeping) while
+the ring is full or empty. The producer closes the ring when it's done, and
+the consumer can cancel it to stop a producer that's waiting.
+
+*/
+
+template <typename T>
+class SpscRingBuffer {
+public:
+  SpscRingBuffer(unsigned int capacity) : slots(capacity + 1), head(0), tail(0), closed(false), cancelled(false) { }
+
+  // producer: the next free slot, or NULL if the consumer has cancelled.
+  // Checked whether or not the ring is full, so a cancelled producer
+  // doesn't go on filling the free slots.
+  T* waitForWriteSlot() {
+    unsigned int spins = 0;
+    unsigned int t = tail.load(std::memory_order_relaxed);
+    if (cancelled.load(std::memory_order_acquire)) return NULL;
+    while (next(t) == head.load(std::memory_order_acquire)) {
+      if (cancelled.load(std::memory_order_acquire)) return NULL;
+      backOff(spins);
+    }
+    return &slots[t];
+  }
+
+  void publish() {
+    tail.store(next(tail.load(std::memory_order_relaxed)), std::memory_order_release);
+  }
+
+  void close() {
+    closed.store(true, std::memory_order_release);
+  }
+
+  // consumer: the next filled slot, or NULL once closed and drained
+  T* waitForReadSlot() {
+    unsigned int spins = 0;
+    unsigned int h = head.load(std::memory_order_relaxed);
+    while (h == tail.load(std::memory_order_acquire)) {
+      if (closed.load(std::memory_order_acquire)) {
+        // anything published before closing is visible by now
+        if (h == tail.load(std::memory_order_acquire)) return NULL;
+        break;
+      }
+      backOff(spins);
+    }
+    return &slots[h];
+  }
+
+  void release() {
+    head.store(next(head.load(std::memory_order_relaxed)), std::memory_order_release);
+  }
+
+  void cancel() {
+    cancelled.store(true, std::memory_order_release);
+  }
+
+private:
+  std::vector<T> slots; // one always empty, to tell full from empty
+  std::atomic<unsigned int> head; // next to read; written by the consumer
+  std::atomic<unsigned int> tail; // next to write; written by the producer
+  std::atomic<bool> closed;
+  std::atomic<bool> cancelled;
+
+  unsigned int next(unsigned int i) const {
+    return (i + 1 == slots.size() ? 0 : i + 1);
+  }
+
+  static void backOff(unsigned int& spins) {
+    spins++;
+    if (spins < 64) return;
+    if (spins < 128) {
+      QThread::yieldCurrentThread();
+    } else {
+      QThread::usleep(100);
+    }
+  }
+};
+
+#endif // SPSCRINGBUFFER_H
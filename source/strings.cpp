@@ -148,14 +148,9 @@ QString GuiStrings::libavCouldNotOpenCodec(const char* name, int result) const {
   return tr("Could not open audio codec %1 (%2)").arg(name).arg(QString::number(result));
 }
 
-QString GuiStrings::libavCouldNotCreateResampleContext() const {
+QString GuiStrings::libavUnsupportedSampleFormat(const char* name) const {
   //: Status of an individual file in the Batch window
-  return tr("Could not create ReSampleContext");
-}
-
-QString GuiStrings::libavCouldNotResample() const {
-  //: Status of an individual file in the Batch window
-  return tr("Could not resample");
+  return tr("Audio stream has unsupported sample format %1").arg(name);
 }
 
 QString GuiStrings::libavTooManyBadPackets(int n) const {
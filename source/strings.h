@@ -56,8 +56,7 @@ public:
   QString libavCouldNotFindAudioStream() const;
   QString libavUnsupportedCodec() const;
   QString libavCouldNotOpenCodec(const char*, int) const;
-  QString libavCouldNotCreateResampleContext() const;
-  QString libavCouldNotResample() const;
+  QString libavUnsupportedSampleFormat(const char*) const;
   QString libavTooManyBadPackets(int) const;
   QString durationExceedsPreference(int, int, int) const;
 
@@ -0,0 +1,99 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "analysiscontexttest.h"
+
+static KeyFinder::AudioData testAudio() {
+    PcmFileDecoder d("../is_KeyFinder/test-resources/readTags/wav.wav", 60);
+    KeyFinder::AudioData audio;
+    d.decodeNextAudioChunk(audio, d.getFrameRate() * 10);
+    return audio;
+}
+
+static KeyFinder::key_t analyse(KeyFinder::KeyFinder& kf, KeyFinder::Workspace& w, const KeyFinder::AudioData& audio) {
+    kf.progressiveChromagram(audio, w);
+    kf.finalChromagram(w);
+    return kf.keyOfChromagram(w);
+}
+
+static AnalysisContext* contextOfPoolThread() {
+    return AnalysisContext::forCurrentThread();
+}
+
+TEST (AnalysisContextTest, OnePerThread) {
+    AnalysisContext* here = AnalysisContext::forCurrentThread();
+    ASSERT_EQ(here, AnalysisContext::forCurrentThread());
+    AnalysisContext* there = QtConcurrent::run(contextOfPoolThread).result();
+    ASSERT_TRUE(there != NULL);
+    ASSERT_NE(here, there);
+}
+
+TEST (AnalysisContextTest, ResetKeepsFftAdapter) {
+    AnalysisContext c;
+    analyse(c.getKeyFinder(), c.getWorkspace(), testAudio());
+    KeyFinder::FftAdapter* fft = c.getWorkspace().getFftAdapter();
+    ASSERT_TRUE(fft != NULL);
+    ASSERT_TRUE(c.getWorkspace().chromagram != NULL);
+    c.reset();
+    ASSERT_EQ(fft, c.getWorkspace().getFftAdapter());
+    ASSERT_TRUE(c.getWorkspace().chromagram == NULL);
+}
+
+TEST (AnalysisContextTest, ReuseMatchesFreshWorkspace) {
+    KeyFinder::AudioData audio = testAudio();
+    KeyFinder::KeyFinder kf;
+    KeyFinder::Workspace fresh;
+    KeyFinder::key_t expected = analyse(kf, fresh, audio);
+    AnalysisContext c;
+    for (int i = 0; i < 3; i++) {
+        c.reset();
+        ASSERT_EQ(expected, analyse(c.getKeyFinder(), c.getWorkspace(), audio));
+    }
+}
+
+// a benchmark rather than a test; run with --gtest_also_run_disabled_tests
+TEST (AnalysisContextTest, DISABLED_BenchmarkPerFileSetup) {
+    KeyFinder::AudioData audio = testAudio();
+    const int files = 200;
+    QElapsedTimer timer;
+
+    // the baseline: one shared KeyFinder, as the old static one, and a new Workspace per file
+    KeyFinder::KeyFinder kf;
+    timer.start();
+    for (int i = 0; i < files; i++) {
+        KeyFinder::Workspace w;
+        analyse(kf, w, audio);
+    }
+    qint64 freshNs = timer.nsecsElapsed();
+
+    AnalysisContext c;
+    timer.restart();
+    for (int i = 0; i < files; i++) {
+        c.reset();
+        analyse(c.getKeyFinder(), c.getWorkspace(), audio);
+    }
+    qint64 reusedNs = timer.nsecsElapsed();
+
+    printf("Per file: %.3f ms with a shared KeyFinder and fresh Workspace, %.3f ms reusing a context\n",
+           freshNs / 1e6 / files, reusedNs / 1e6 / files);
+    RecordProperty("freshMicroseconds", (int) (freshNs / 1000 / files));
+    RecordProperty("reusedMicroseconds", (int) (reusedNs / 1000 / files));
+}
@@ -0,0 +1,71 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "analysisresultqueuetest.h"
+
+static std::unique_ptr<KeyFinderResultWrapper> resultForRow(int row) {
+    std::unique_ptr<KeyFinderResultWrapper> result(new KeyFinderResultWrapper());
+    result->batchRow = row;
+    return result;
+}
+
+TEST (AnalysisResultQueueTest, TakesInOrderUntilEmpty) {
+    AnalysisResultQueue queue;
+    queue.push(resultForRow(3));
+    queue.push(resultForRow(1));
+    ASSERT_EQ(2u, queue.size());
+    ASSERT_EQ(3, queue.take()->batchRow);
+    ASSERT_EQ(1, queue.take()->batchRow);
+    ASSERT_TRUE(queue.take() == NULL);
+    ASSERT_EQ(0u, queue.size());
+}
+
+TEST (AnalysisResultQueueTest, HandsOverWithoutCopying) {
+    AnalysisResultQueue queue;
+    std::unique_ptr<KeyFinderResultWrapper> result = resultForRow(0);
+    KeyFinderResultWrapper* original = result.get();
+    queue.push(std::move(result));
+    ASSERT_TRUE(result == NULL);
+    ASSERT_EQ(original, queue.take().get());
+}
+
+TEST (AnalysisResultQueueTest, SignalsOncePerBacklog) {
+    AnalysisResultQueue queue;
+    int signals = 0;
+    QObject::connect(&queue, &AnalysisResultQueue::resultsReady, [&signals]() { signals++; });
+    queue.push(resultForRow(0));
+    queue.push(resultForRow(1));
+    ASSERT_EQ(1, signals);
+    while (queue.take() != NULL) { }
+    queue.push(resultForRow(2));
+    ASSERT_EQ(2, signals);
+}
+
+TEST (AnalysisResultQueueTest, CollectsFromManyThreads) {
+    AnalysisResultQueue queue;
+    QList<int> rows;
+    for (int i = 0; i < 1000; i++) rows.push_back(i);
+    QtConcurrent::blockingMap(rows, [&queue](const int& row) { queue.push(resultForRow(row)); });
+    std::vector<bool> seen(rows.size(), false);
+    std::unique_ptr<KeyFinderResultWrapper> result;
+    while ((result = queue.take()) != NULL) seen[result->batchRow] = true;
+    ASSERT_EQ(seen.end(), std::find(seen.begin(), seen.end(), false));
+}
@@ -0,0 +1,330 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "asynckeyprocesstest.h"
+
+// frame rate of the synthetic files; low, so long ones stay small
+const int SYNTHETIC_RATE = 4410;
+
+// 16-bit mono: any silence, then an A major triad, changing to a C major
+// triad at changeSeconds if given
+static QString syntheticWav(const QTemporaryDir& dir, const QString& name, int seconds, int silentSeconds = 0, int changeSeconds = -1) {
+    QString path = dir.path() + "/" + name;
+    QFile file(path);
+    EXPECT_TRUE(file.open(QIODevice::WriteOnly));
+    quint32 dataBytes = (quint32) seconds * SYNTHETIC_RATE * 2;
+    uchar header[44];
+    memcpy(header, "RIFF", 4);
+    qToLittleEndian<quint32>(36 + dataBytes, header + 4);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    qToLittleEndian<quint32>(16, header + 16);
+    qToLittleEndian<quint16>(1, header + 20);
+    qToLittleEndian<quint16>(1, header + 22);
+    qToLittleEndian<quint32>(SYNTHETIC_RATE, header + 24);
+    qToLittleEndian<quint32>(SYNTHETIC_RATE * 2, header + 28);
+    qToLittleEndian<quint16>(2, header + 32);
+    qToLittleEndian<quint16>(16, header + 34);
+    memcpy(header + 36, "data", 4);
+    qToLittleEndian<quint32>(dataBytes, header + 40);
+    file.write((const char*) header, 44);
+    std::vector<qint16> second(SYNTHETIC_RATE);
+    for (int s = 0; s < seconds; s++) {
+        bool changed = changeSeconds >= 0 && s >= changeSeconds;
+        double root = (changed ? 261.63 : 220.0);
+        double third = (changed ? 329.63 : 277.18);
+        double fifth = (changed ? 392.0 : 329.63);
+        for (int i = 0; i < SYNTHETIC_RATE; i++) {
+            double t = (double) i / SYNTHETIC_RATE;
+            double v = sin(2 * M_PI * root * t) + sin(2 * M_PI * third * t) + sin(2 * M_PI * fifth * t);
+            second[i] = qToLittleEndian<qint16>((qint16) (s < silentSeconds ? 0 : v * 8000));
+        }
+        file.write((const char*) &second[0], SYNTHETIC_RATE * 2);
+    }
+    return path;
+}
+
+// defaults, read from and saved to nowhere, with the result cache off so
+// every call really analyses
+static Preferences testPreferences() {
+    Preferences prefs(new SettingsWrapperFake());
+    prefs.setResultCache(false);
+    return prefs;
+}
+
+static KeyFinderResultWrapper analyse(const QString& path, const Preferences& prefs, result_payload_t payload = RESULT_PAYLOAD_KEY) {
+    AsyncFileObject object(path, prefs, 0);
+    object.payload = payload;
+    return keyDetectionProcess(object);
+}
+
+#ifdef Q_OS_LINUX
+static qint64 peakResidentKiB() {
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly)) return -1;
+    foreach (const QByteArray& line, status.readAll().split('\n')) {
+        if (line.startsWith("VmHWM:")) return line.mid(6).trimmed().split(' ')[0].toLongLong();
+    }
+    return -1;
+}
+
+static void resetPeakResident() {
+    QFile clearRefs("/proc/self/clear_refs");
+    if (clearRefs.open(QIODevice::WriteOnly)) clearRefs.write("5");
+}
+#endif
+
+TEST (AsyncKeyProcessTest, RejectsLongFilesWithoutStreaming) {
+    Preferences prefs = testPreferences();
+    prefs.setMaxDuration(1);
+    prefs.setStreamLongFiles(false);
+    KeyFinderResultWrapper result = analyse("../is_KeyFinder/test-resources/90secondsine.mp3", prefs);
+    ASSERT_EQ(GuiStrings::getInstance()->durationExceedsPreference(1, 30, 1), result.errorMessage);
+}
+
+TEST (AsyncKeyProcessTest, StreamsLongFiles) {
+    Preferences prefs = testPreferences();
+    prefs.setMaxDuration(1);
+    KeyFinderResultWrapper result = analyse("../is_KeyFinder/test-resources/90secondsine.mp3", prefs, RESULT_PAYLOAD_CHROMAGRAM);
+    ASSERT_TRUE(result.errorMessage.isEmpty());
+    ASSERT_EQ(1u, result.fullChromagram.getHops());
+}
+
+TEST (AsyncKeyProcessTest, KeepsOnlyTheKeyByDefault) {
+    Preferences prefs = testPreferences();
+    KeyFinderResultWrapper result = analyse("../is_KeyFinder/test-resources/90secondsine.mp3", prefs);
+    ASSERT_TRUE(result.errorMessage.isEmpty());
+    ASSERT_EQ(0u, result.fullChromagram.getHops());
+    ASSERT_TRUE(result.chromagramSummary.empty());
+}
+
+// what a batch holds on to is what comes back through the future or the
+// queue, so the chromagram must be gone by then, not just unused
+TEST (AsyncKeyProcessTest, HandsBackOnlyTheKeyByDefault) {
+    Preferences prefs = testPreferences();
+    AsyncFileObject object("../is_KeyFinder/test-resources/90secondsine.mp3", prefs, 0);
+    QFuture<KeyFinderResultWrapper> future = QtConcurrent::run(keyDetectionProcess, object);
+    ASSERT_TRUE(future.result().errorMessage.isEmpty());
+    ASSERT_EQ(0u, future.result().fullChromagram.getHops());
+    ASSERT_TRUE(future.result().chromagramSummary.empty());
+    AnalysisResultQueue queue;
+    object.resultQueue = &queue;
+    queuedKeyDetectionProcess(object);
+    std::unique_ptr<KeyFinderResultWrapper> queued = queue.take();
+    ASSERT_TRUE(queued != NULL);
+    ASSERT_TRUE(queued->errorMessage.isEmpty());
+    ASSERT_EQ(0u, queued->fullChromagram.getHops());
+    ASSERT_TRUE(queued->chromagramSummary.empty());
+    ASSERT_EQ(future.result().core, queued->core);
+}
+
+TEST (AsyncKeyProcessTest, SummarisesChromagramOnRequest) {
+    Preferences prefs = testPreferences();
+    KeyFinderResultWrapper summarised = analyse("../is_KeyFinder/test-resources/90secondsine.mp3", prefs, RESULT_PAYLOAD_SUMMARY);
+    KeyFinderResultWrapper full = analyse("../is_KeyFinder/test-resources/90secondsine.mp3", prefs, RESULT_PAYLOAD_CHROMAGRAM);
+    ASSERT_EQ(0u, summarised.fullChromagram.getHops());
+    ASSERT_EQ(full.fullChromagram.getBands(), summarised.chromagramSummary.size());
+    ASSERT_EQ(full.core, summarised.core);
+    std::vector<double> collapsed = full.fullChromagram.collapseToOneHop();
+    for (unsigned int b = 0; b < collapsed.size(); b++) {
+        ASSERT_NEAR(collapsed[b], summarised.chromagramSummary[b], 1e-9);
+    }
+}
+
+TEST (AsyncKeyProcessTest, SplitsLongFilesIntoPartsWithTheSameResult) {
+    QTemporaryDir dir;
+    // the change falls inside a part, not on a boundary between parts
+    QString path = syntheticWav(dir, "tenminutes.wav", 10 * 60, 0, 330);
+    Preferences prefs = testPreferences();
+    prefs.setKeyTimelineSeconds(30);
+    prefs.setParallelChunkMinutes(0);
+    KeyFinderResultWrapper whole = analyse(path, prefs, RESULT_PAYLOAD_SUMMARY);
+    prefs.setParallelChunkMinutes(1);
+    prefs.setEarlyStop(true); // doesn't apply to parts
+    prefs.setEarlyStopSeconds(30);
+    KeyFinderResultWrapper split = analyse(path, prefs, RESULT_PAYLOAD_SUMMARY);
+    ASSERT_TRUE(split.errorMessage.isEmpty());
+    ASSERT_EQ(whole.core, split.core);
+    ASSERT_EQ(whole.chromagramSummary.size(), split.chromagramSummary.size());
+    for (unsigned int b = 0; b < whole.chromagramSummary.size(); b++) {
+        ASSERT_NEAR(whole.chromagramSummary[b], split.chromagramSummary[b], 0.05 * whole.chromagramSummary[b] + 1e-9);
+    }
+    // the parts' timelines join up where the key stays the same, and the
+    // change is placed where a single decode places it
+    ASSERT_EQ(2u, whole.keyTimeline.size());
+    ASSERT_EQ(whole.keyTimeline.size(), split.keyTimeline.size());
+    for (unsigned int i = 0; i < whole.keyTimeline.size(); i++) {
+        ASSERT_EQ(whole.keyTimeline[i].key, split.keyTimeline[i].key);
+        ASSERT_NEAR(whole.keyTimeline[i].startSeconds, split.keyTimeline[i].startSeconds, prefs.getDecodeChunkSeconds());
+    }
+    ASSERT_NEAR(600.0, split.keyTimeline.back().endSeconds, 1.0);
+    ASSERT_NEAR(600.0, split.secondsAnalysed, 1.0);
+    ASSERT_EQ(whole.samplesSkipped, split.samplesSkipped);
+}
+
+TEST (AsyncKeyProcessTest, StopsOnceTheKeyHasSettled) {
+    QTemporaryDir dir;
+    QString path = syntheticWav(dir, "tenminutes.wav", 10 * 60);
+    Preferences prefs = testPreferences();
+    KeyFinderResultWrapper whole = analyse(path, prefs);
+    prefs.setEarlyStop(true);
+    prefs.setEarlyStopSeconds(30);
+    KeyFinderResultWrapper early = analyse(path, prefs);
+    ASSERT_TRUE(early.errorMessage.isEmpty());
+    ASSERT_EQ(whole.core, early.core);
+    ASSERT_NEAR(600.0, whole.secondsAnalysed, 1.0);
+    ASSERT_NEAR(600.0, early.durationSeconds, 1.0);
+    ASSERT_LT(early.secondsAnalysed, 120.0);
+}
+
+TEST (AsyncKeyProcessTest, ClassifiesEachConfigurationFromOneDecode) {
+    QTemporaryDir dir;
+    QString path = syntheticWav(dir, "twominutes.wav", 2 * 60, 0, 90);
+    Preferences prefs = testPreferences();
+    AsyncFileObject object(path, prefs, 0);
+    Preferences timed(prefs);
+    timed.setKeyTimelineSeconds(30);
+    Preferences early(prefs);
+    early.setEarlyStop(true);
+    early.setEarlyStopSeconds(30);
+    object.configurations.push_back(timed);
+    object.configurations.push_back(early);
+    KeyFinderResultWrapper single = analyse(path, prefs);
+    KeyFinderResultWrapper fanned = keyDetectionProcess(object);
+    ASSERT_TRUE(fanned.errorMessage.isEmpty());
+    ASSERT_EQ(single.core, fanned.core);
+    ASSERT_EQ(2u, fanned.configurations.size());
+    // the primary configuration still decides how much was decoded, and
+    // keeps no timeline of its own
+    ASSERT_NEAR(120.0, fanned.secondsAnalysed, 1.0);
+    ASSERT_TRUE(fanned.keyTimeline.empty());
+    // each of the others gets what its own settings asked for
+    const ConfigurationResult& withTimeline = fanned.configurations[0];
+    ASSERT_NEAR(120.0, withTimeline.secondsAnalysed, 1.0);
+    ASSERT_GE(withTimeline.keyTimeline.size(), 2u);
+    ASSERT_NE(withTimeline.keyTimeline.front().key, withTimeline.keyTimeline.back().key);
+    const ConfigurationResult& stoppedEarly = fanned.configurations[1];
+    ASSERT_LT(stoppedEarly.secondsAnalysed, 120.0);
+    ASSERT_TRUE(stoppedEarly.keyTimeline.empty());
+}
+
+TEST (AsyncKeyProcessTest, OnlyLaneSettingsCanDiffer) {
+    ASSERT_TRUE(AnalysisLane::settingNames().contains("keyTimelineSeconds"));
+    ASSERT_TRUE(AnalysisLane::settingNames().contains("earlyStop"));
+    ASSERT_FALSE(AnalysisLane::settingNames().contains("silenceThreshold"));
+    ASSERT_FALSE(AnalysisLane::settingNames().contains("decodeChunkSeconds"));
+}
+
+TEST (AsyncKeyProcessTest, SkipsSilence) {
+    QTemporaryDir dir;
+    QString path = syntheticWav(dir, "hiddentrack.wav", 90, 60);
+    Preferences prefs = testPreferences();
+    prefs.setKeyTimelineSeconds(30);
+    prefs.setSilenceGate(true);
+    KeyFinderResultWrapper gated = analyse(path, prefs);
+    prefs.setSilenceGate(false);
+    KeyFinderResultWrapper ungated = analyse(path, prefs);
+    ASSERT_TRUE(gated.errorMessage.isEmpty());
+    ASSERT_EQ(ungated.core, gated.core);
+    ASSERT_EQ(0u, ungated.samplesSkipped);
+    // the leading minute, give or take a block either side of the edge
+    ASSERT_NEAR(60.0 * SYNTHETIC_RATE, (double) gated.samplesSkipped, 0.2 * SYNTHETIC_RATE);
+    // skipped audio still counts towards where things happen
+    ASSERT_NEAR(90.0, gated.secondsAnalysed, 1.0);
+    ASSERT_FALSE(gated.keyTimeline.empty());
+    ASSERT_NEAR(90.0, gated.keyTimeline.back().endSeconds, 1.0);
+    ASSERT_EQ(ungated.keyTimeline.back().key, gated.keyTimeline.back().key);
+}
+
+TEST (AsyncKeyProcessTest, KeysEachTrackFromOneDecode) {
+    QTemporaryDir dir;
+    // silence, then one key, then another: each track only hears its own
+    QString image = syntheticWav(dir, "image.wav", 180, 60, 120);
+    Preferences prefs = testPreferences();
+    AsyncFileObject object(image, prefs, 0);
+    object.tracks.push_back(TrackRange(0.0, 60.0, 4));
+    object.tracks.push_back(TrackRange(60.0, 120.0, 5));
+    object.tracks.push_back(TrackRange(120.0, -1.0, 6));
+    object.tracks.push_back(TrackRange(600.0, -1.0, 7));
+    std::vector<KeyFinderResultWrapper> results = trackKeyDetectionProcess(object);
+    KeyFinderResultWrapper first = analyse(syntheticWav(dir, "first.wav", 60), prefs);
+    KeyFinderResultWrapper second = analyse(syntheticWav(dir, "second.wav", 60, 0, 0), prefs);
+    ASSERT_NE(first.core, second.core);
+    ASSERT_EQ(4u, results.size());
+    ASSERT_EQ(4, results[0].batchRow);
+    ASSERT_TRUE(results[0].errorMessage.isEmpty());
+    ASSERT_EQ(KeyFinder::SILENCE, results[0].core);
+    ASSERT_NEAR(60.0, results[0].durationSeconds, 0.1);
+    ASSERT_EQ(5, results[1].batchRow);
+    ASSERT_TRUE(results[1].errorMessage.isEmpty());
+    ASSERT_EQ(first.core, results[1].core);
+    ASSERT_NEAR(60.0, results[1].durationSeconds, 0.1);
+    ASSERT_EQ(6, results[2].batchRow);
+    ASSERT_TRUE(results[2].errorMessage.isEmpty());
+    ASSERT_EQ(second.core, results[2].core);
+    ASSERT_NEAR(60.0, results[2].durationSeconds, 0.1);
+    ASSERT_EQ(7, results[3].batchRow);
+    ASSERT_FALSE(results[3].errorMessage.isEmpty());
+}
+
+#ifdef Q_OS_LINUX
+TEST (AsyncKeyProcessTest, StreamsThreeHoursInBoundedMemory) {
+    QTemporaryDir dir;
+    QString path = syntheticWav(dir, "threehours.wav", 3 * 60 * 60); // ~95 MiB
+    Preferences prefs = testPreferences();
+    ASSERT_EQ(60, prefs.getMaxDuration());
+    prefs.setParallelChunkMinutes(0); // one lane, streaming, not parts
+    resetPeakResident();
+    qint64 before = peakResidentKiB();
+    KeyFinderResultWrapper result = analyse(path, prefs, RESULT_PAYLOAD_CHROMAGRAM);
+    qint64 peak = peakResidentKiB();
+    ASSERT_TRUE(result.errorMessage.isEmpty());
+    ASSERT_EQ(1u, result.fullChromagram.getHops());
+    // holding the decoded input would blow well past this. The full
+    // chromagram, at this frame rate, would only be about 7 MB, so that it
+    // isn't held is shown by StreamingKeepsNoHopsInTheWorkspace instead.
+    ASSERT_LT(peak - before, 48 * 1024);
+}
+#endif
+
+TEST (AsyncKeyProcessTest, StreamingKeepsNoHopsInTheWorkspace) {
+    QTemporaryDir dir;
+    QString path = syntheticWav(dir, "tenminutes.wav", 10 * 60);
+    Preferences prefs = testPreferences();
+    KeyFinder::KeyFinder kf;
+    KeyFinder::Workspace streamed;
+    KeyFinder::Workspace held;
+    AnalysisLane streaming(kf, streamed, prefs, true, true);
+    AnalysisLane holding(kf, held, prefs, true, false);
+    AudioDecoderFactory factory;
+    std::unique_ptr<AudioDecoder> decoder(factory.createAudioDecoder(path, NO_MAX_DURATION));
+    KeyFinder::AudioData chunk;
+    while (decoder->decodeNextAudioChunk(chunk, SYNTHETIC_RATE * prefs.getDecodeChunkSeconds())) {
+        streaming.analyse(chunk);
+        holding.analyse(chunk);
+        // each chunk's hops are folded into the running sum straight away
+        ASSERT_TRUE(streamed.chromagram == NULL || streamed.chromagram->getHops() == 0);
+    }
+    unsigned int hops = held.chromagram->getHops();
+    ASSERT_GT(hops, 600u); // 10 minutes at 4096 samples a hop
+    ASSERT_EQ(hops, streaming.getAccumulator().getHops());
+    streaming.finish();
+    ASSERT_EQ(1u, streamed.chromagram->getHops());
+}
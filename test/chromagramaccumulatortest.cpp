@@ -0,0 +1,77 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "chromagramaccumulatortest.h"
+
+static KeyFinder::Chromagram* rampChromagram(unsigned int hops, double offset) {
+    KeyFinder::Chromagram* c = new KeyFinder::Chromagram(hops);
+    for (unsigned int h = 0; h < hops; h++)
+        for (unsigned int b = 0; b < c->getBands(); b++)
+            c->setMagnitude(h, b, offset + h + b);
+    return c;
+}
+
+TEST (ChromagramAccumulatorTest, AbsorbTakesTheChromagram) {
+    KeyFinder::Workspace w;
+    w.chromagram = rampChromagram(3, 0.0);
+    ChromagramAccumulator a;
+    a.absorb(w);
+    ASSERT_TRUE(w.chromagram == NULL);
+    ASSERT_EQ(3u, a.getHops());
+    a.absorb(w); // nothing there; no-op
+    ASSERT_EQ(3u, a.getHops());
+}
+
+TEST (ChromagramAccumulatorTest, CollapsesToTheMean) {
+    KeyFinder::Workspace w;
+    KeyFinder::Chromagram* whole = rampChromagram(4, 1.0);
+    std::vector<double> expected = whole->collapseToOneHop();
+    delete whole;
+    ChromagramAccumulator a;
+    // the same hops, arriving in two pieces
+    w.chromagram = rampChromagram(2, 1.0);
+    a.absorb(w);
+    w.chromagram = rampChromagram(2, 3.0);
+    a.absorb(w);
+    KeyFinder::Chromagram* mean = a.collapse();
+    ASSERT_EQ(1u, mean->getHops());
+    for (unsigned int b = 0; b < mean->getBands(); b++)
+        ASSERT_FLOAT_EQ(expected[b], mean->getMagnitude(0, b));
+    delete mean;
+}
+
+TEST (ChromagramAccumulatorTest, MergesAnotherPartOfTheFile) {
+    KeyFinder::Workspace w;
+    KeyFinder::Chromagram* whole = rampChromagram(4, 1.0);
+    std::vector<double> expected = whole->collapseToOneHop();
+    delete whole;
+    ChromagramAccumulator first, second;
+    w.chromagram = rampChromagram(2, 1.0);
+    first.absorb(w);
+    w.chromagram = rampChromagram(2, 3.0);
+    second.absorb(w);
+    first.merge(second);
+    ASSERT_EQ(4u, first.getHops());
+    KeyFinder::Chromagram* mean = first.collapse();
+    for (unsigned int b = 0; b < mean->getBands(); b++)
+        ASSERT_FLOAT_EQ(expected[b], mean->getMagnitude(0, b));
+    delete mean;
+}
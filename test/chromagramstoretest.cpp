@@ -0,0 +1,169 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "chromagramstoretest.h"
+
+static QString touch(const QTemporaryDir& dir, const QString& name) {
+    QFile file(dir.path() + "/" + name);
+    file.open(QIODevice::WriteOnly);
+    return file.fileName();
+}
+
+// bands run up from A in semitones
+static std::vector<double> triad(unsigned int a, unsigned int b, unsigned int c) {
+    std::vector<double> bands(72);
+    for (unsigned int band = 0; band < bands.size(); band++) {
+        unsigned int pc = band % 12;
+        bands[band] = (pc == a || pc == b || pc == c) ? 0.8 + 0.001 * band : 0.03;
+    }
+    return bands;
+}
+
+TEST (ChromagramStoreTest, QuantisesCloseToTheOriginal) {
+    QTemporaryDir dir;
+    QString track = touch(dir, "track.flac");
+    std::vector<double> bands = triad(0, 4, 7);
+    ChromagramStore store(dir.path() + "/chromagrams.store");
+    store.store(track, bands, 60.0, 60.0);
+    std::vector<double> back = store.retrieve(track);
+    ASSERT_EQ(bands.size(), back.size());
+    for (unsigned int b = 0; b < bands.size(); b++) ASSERT_NEAR(bands[b], back[b], 1e-4);
+    ASSERT_TRUE(store.retrieve(dir.path() + "/missing.flac").empty());
+}
+
+TEST (ChromagramStoreTest, PersistsAndKeepsTheLatestRecord) {
+    QTemporaryDir dir;
+    QString track = touch(dir, "track.flac");
+    QString other = touch(dir, "other.flac");
+    {
+        ChromagramStore store(dir.path() + "/chromagrams.store");
+        store.store(track, triad(0, 4, 7), 60.0, 60.0);
+        store.store(other, triad(0, 4, 7), 60.0, 60.0);
+        store.store(track, triad(3, 7, 10), 60.0, 60.0);
+    }
+    ChromagramStore store(dir.path() + "/chromagrams.store");
+    ASSERT_EQ(2u, store.size());
+    ASSERT_TRUE(store.contains(other));
+    ASSERT_NEAR(0.03, store.retrieve(track)[0], 1e-4);
+    // compact: a few hundred bytes per file, most of them the path
+    ASSERT_LT(QFileInfo(dir.path() + "/chromagrams.store").size(), 3 * 500);
+}
+
+TEST (ChromagramStoreTest, ReclassifiesWithoutDecoding) {
+    QTemporaryDir dir;
+    QString major = touch(dir, "major.flac");
+    QString minor = touch(dir, "minor.flac");
+    ChromagramStore store(dir.path() + "/chromagrams.store");
+    store.store(major, triad(0, 4, 7), 60.0, 60.0);
+    store.store(minor, triad(0, 3, 7), 60.0, 60.0);
+    KeyFinder::KeyFinder kf;
+    QMap<QString, ChromagramStore::Classification> keys = store.reclassify(kf);
+    ASSERT_EQ(2, keys.size());
+    KeyFinder::Workspace w;
+    w.chromagram = new KeyFinder::Chromagram(1);
+    std::vector<double> bands = store.retrieve(major);
+    for (unsigned int b = 0; b < bands.size(); b++) w.chromagram->setMagnitude(0, b, bands[b]);
+    ASSERT_EQ(kf.keyOfChromagram(w), keys[QFileInfo(major).canonicalFilePath()].key);
+    ASSERT_NE(keys[QFileInfo(major).canonicalFilePath()].key, keys[QFileInfo(minor).canonicalFilePath()].key);
+}
+
+TEST (ChromagramStoreTest, PassesOverFilesThatHaveChanged) {
+    QTemporaryDir dir;
+    QString path = dir.path() + "/chromagrams.store";
+    QString changed = touch(dir, "changed.flac");
+    QString same = touch(dir, "same.flac");
+    {
+        ChromagramStore store(path);
+        store.store(changed, triad(0, 4, 7), 60.0, 60.0);
+        store.store(same, triad(0, 4, 7), 60.0, 60.0);
+    }
+    QFile file(changed);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write("different audio");
+    file.close();
+    ChromagramStore store(path);
+    ASSERT_FALSE(store.contains(changed));
+    ASSERT_TRUE(store.retrieve(changed).empty());
+    ASSERT_TRUE(store.contains(same));
+    KeyFinder::KeyFinder kf;
+    QMap<QString, ChromagramStore::Classification> keys = store.reclassify(kf);
+    ASSERT_EQ(1, keys.size());
+    ASSERT_TRUE(keys.contains(QFileInfo(same).canonicalFilePath()));
+}
+
+TEST (ChromagramStoreTest, KeepsHowMuchOfTheFileWasAnalysed) {
+    QTemporaryDir dir;
+    QString path = dir.path() + "/chromagrams.store";
+    QString track = touch(dir, "track.flac");
+    {
+        ChromagramStore store(path);
+        store.store(track, triad(0, 4, 7), 90.0, 240.0);
+    }
+    ChromagramStore store(path);
+    KeyFinder::KeyFinder kf;
+    QMap<QString, ChromagramStore::Classification> keys = store.reclassify(kf);
+    ASSERT_EQ(1, keys.size());
+    ASSERT_NEAR(90.0, keys.first().secondsAnalysed, 1e-3);
+    ASSERT_NEAR(240.0, keys.first().durationSeconds, 1e-3);
+}
+
+TEST (ChromagramStoreTest, IgnoresOtherVersions) {
+    QTemporaryDir dir;
+    QFile file(dir.path() + "/chromagrams.store");
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    QDataStream out(&file);
+    out.writeRawData("KFCS", 4);
+    out << (quint32) 99;
+    file.close();
+    QString track = touch(dir, "track.flac");
+    {
+        ChromagramStore store(file.fileName());
+        ASSERT_EQ(0u, store.size());
+        store.store(track, triad(0, 4, 7), 60.0, 60.0);
+    }
+    // the old file made way for a new one
+    ChromagramStore store(file.fileName());
+    ASSERT_TRUE(store.contains(track));
+}
+
+TEST (ChromagramStoreTest, RepairsATruncatedRecord) {
+    QTemporaryDir dir;
+    QString path = dir.path() + "/chromagrams.store";
+    QString track = touch(dir, "track.flac");
+    QString other = touch(dir, "other.flac");
+    QString third = touch(dir, "third.flac");
+    {
+        ChromagramStore store(path);
+        store.store(track, triad(0, 4, 7), 60.0, 60.0);
+        store.store(other, triad(0, 3, 7), 60.0, 60.0);
+    }
+    QFile log(path);
+    ASSERT_TRUE(log.resize(log.size() - 5));
+    {
+        ChromagramStore store(path);
+        ASSERT_TRUE(store.contains(track));
+        ASSERT_FALSE(store.contains(other));
+        store.store(third, triad(3, 7, 10), 60.0, 60.0);
+    }
+    ChromagramStore store(path);
+    ASSERT_TRUE(store.contains(track));
+    ASSERT_TRUE(store.contains(third));
+}
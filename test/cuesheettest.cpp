@@ -0,0 +1,118 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "cuesheettest.h"
+
+static void writeFile(const QString& path, const QByteArray& contents) {
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(contents);
+}
+
+static const char* ALBUM_CUE =
+    "\xEF\xBB\xBFREM GENRE Electronic\r\n"
+    "PERFORMER \"Some Artist\"\r\n"
+    "TITLE \"Some Album\"\r\n"
+    "FILE \"Some Album.wav\" WAVE\r\n"
+    "  TRACK 01 AUDIO\r\n"
+    "    TITLE \"First\"\r\n"
+    "    INDEX 01 00:00:00\r\n"
+    "  TRACK 02 AUDIO\r\n"
+    "    TITLE \"Second\"\r\n"
+    "    PERFORMER \"Guest\"\r\n"
+    "    INDEX 00 03:58:00\r\n"
+    "    INDEX 01 04:00:37\r\n"
+    "  TRACK 03 AUDIO\r\n"
+    "    TITLE \"Third\"\r\n"
+    "    INDEX 01 07:30:00\r\n";
+
+TEST (CueSheetTest, ParsesTracks) {
+    QTemporaryDir dir;
+    writeFile(dir.path() + "/Some Album.wav", "");
+    writeFile(dir.path() + "/album.cue", ALBUM_CUE);
+    CueSheet cue(dir.path() + "/album.cue");
+    ASSERT_TRUE(cue.isValid());
+    ASSERT_EQ(QString("Some Album"), cue.getTitle());
+    ASSERT_EQ(QString("Some Artist"), cue.getPerformer());
+    ASSERT_EQ(3, cue.getTracks().size());
+
+    const CueTrack& first = cue.getTracks()[0];
+    ASSERT_EQ(1, first.number);
+    ASSERT_EQ(QString("First"), first.title);
+    ASSERT_EQ(QString("Some Artist"), first.performer);
+    ASSERT_EQ(QFileInfo(dir.path() + "/Some Album.wav").absoluteFilePath(), first.filePath);
+    ASSERT_DOUBLE_EQ(0.0, first.startSeconds);
+    ASSERT_DOUBLE_EQ(238.0, first.endSeconds); // up to the second track's pregap
+
+    const CueTrack& second = cue.getTracks()[1];
+    ASSERT_EQ(QString("Guest"), second.performer);
+    ASSERT_DOUBLE_EQ(240.0 + 37.0 / 75, second.startSeconds);
+    ASSERT_DOUBLE_EQ(450.0, second.endSeconds);
+
+    ASSERT_DOUBLE_EQ(450.0, cue.getTracks()[2].startSeconds);
+    ASSERT_LT(cue.getTracks()[2].endSeconds, 0.0);
+}
+
+TEST (CueSheetTest, FindsACompressedImage) {
+    QTemporaryDir dir;
+    writeFile(dir.path() + "/Some Album.flac", "");
+    writeFile(dir.path() + "/album.cue", ALBUM_CUE);
+    CueSheet cue(dir.path() + "/album.cue");
+    ASSERT_TRUE(cue.isValid());
+    ASSERT_EQ(QFileInfo(dir.path() + "/Some Album.flac").absoluteFilePath(), cue.getTracks()[0].filePath);
+}
+
+TEST (CueSheetTest, SkipsDataTracks) {
+    QTemporaryDir dir;
+    writeFile(dir.path() + "/image.bin", "");
+    writeFile(dir.path() + "/image.cue",
+        "FILE \"image.bin\" BINARY\n"
+        "  TRACK 01 MODE1/2352\n"
+        "    INDEX 01 00:00:00\n"
+        "  TRACK 02 AUDIO\n"
+        "    INDEX 01 10:00:00\n");
+    CueSheet cue(dir.path() + "/image.cue");
+    ASSERT_EQ(1, cue.getTracks().size());
+    ASSERT_EQ(2, cue.getTracks()[0].number);
+    ASSERT_DOUBLE_EQ(600.0, cue.getTracks()[0].startSeconds);
+}
+
+TEST (CueSheetTest, InvalidWithoutTracks) {
+    QTemporaryDir dir;
+    writeFile(dir.path() + "/empty.cue", "REM nothing here\n");
+    ASSERT_FALSE(CueSheet(dir.path() + "/empty.cue").isValid());
+    ASSERT_FALSE(CueSheet(dir.path() + "/missing.cue").isValid());
+}
+
+TEST (CueSheetTest, ParsesTimes) {
+    ASSERT_DOUBLE_EQ(61.0 + 15.0 / 75, CueSheet::parseTime("01:01:15"));
+    ASSERT_DOUBLE_EQ(6000.0, CueSheet::parseTime("100:00:00"));
+    ASSERT_LT(CueSheet::parseTime("01:01"), 0.0);
+    ASSERT_LT(CueSheet::parseTime("00:00:75"), 0.0);
+    ASSERT_LT(CueSheet::parseTime("aa:00:00"), 0.0);
+}
+
+TEST (CueSheetTest, Tokenises) {
+    QStringList words = CueSheet::tokenise("  FILE \"My Album.wav\"  WAVE");
+    ASSERT_EQ(3, words.size());
+    ASSERT_EQ(QString("My Album.wav"), words[1]);
+    ASSERT_EQ(2, CueSheet::tokenise("TITLE \"\"").size());
+}
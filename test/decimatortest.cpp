@@ -0,0 +1,65 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#include "decimatortest.h"
+
+TEST (DecimatorTest, OutputCount) {
+    Decimator d(4, 44100, 2000.0);
+    std::vector<double> output;
+    for (unsigned int i = 0; i < 1001; i++)
+        d.process(0.0, output);
+    ASSERT_EQ(251u, output.size());
+}
+
+TEST (DecimatorTest, PassesDC) {
+    Decimator d(4, 44100, 2000.0);
+    std::vector<double> output;
+    for (unsigned int i = 0; i < 4000; i++)
+        d.process(1.0, output);
+    ASSERT_NEAR(1.0, output.back(), 0.0001);
+}
+
+TEST (DecimatorTest, RejectsAboveCutoff) {
+    Decimator d(12, 44100, 1800.0);
+    std::vector<double> output;
+    double pi = 4 * atan(1.0);
+    for (unsigned int i = 0; i < 44100; i++)
+        d.process(sin(2 * pi * 5000.0 * i / 44100.0), output);
+    double peak = 0.0;
+    for (unsigned int i = output.size() / 2; i < output.size(); i++)
+        peak = std::max(peak, fabs(output[i]));
+    ASSERT_LT(peak, 0.001);
+}
+
+TEST (DecimatorTest, AnalysisFactor) {
+    ASSERT_EQ(1u, Decimator::analysisFactor(3675));
+}
+
+TEST (DecimatorTest, AnalysisFactorKeepsTheTransitionBandBelowNyquist) {
+    unsigned int rates[] = { 22050, 44100, 48000, 96000 };
+    for (unsigned int r = 0; r < 4; r++) {
+        unsigned int f = Decimator::analysisFactor(rates[r]);
+        ASSERT_GT(f, 1u);
+        double nyquist = rates[r] / 2.0 / f;
+        ASSERT_LE(Decimator::analysisCutoff() + Decimator::transitionWidth(f, rates[r]), nyquist);
+    }
+}
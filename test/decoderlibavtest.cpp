@@ -21,6 +21,18 @@
 
 #include "decoderlibavtest.h"
 
+// opens a decoder and decodes its first chunk; -1 on failure
+static int openAndDecodeFirstChunk(const QString& path) {
+    try {
+        AudioFileDecoder d(path, 60);
+        KeyFinder::AudioData chunk;
+        d.decodeNextAudioChunk(chunk, d.getFrameRate());
+        return (int) chunk.getSampleCount();
+    } catch (...) {
+        return -1;
+    }
+}
+
 TEST (AudioFileDecoderTest, MissingFile) {
     QString path("noFileHere");
     QString expectedMessage = GuiStrings::getInstance()->libavCouldNotOpenFile(-2);
@@ -68,3 +80,128 @@ TEST (AudioFileDecoderTest, OverMaxDuration) {
     }
     ASSERT_TRUE(exceptionThrown);
 }
+
+TEST (AudioFileDecoderTest, DecodesIntoReusedChunk) {
+    QString path("../is_KeyFinder/test-resources/90secondsine.mp3");
+    AudioFileDecoder d(path, 60);
+    unsigned int chunkFrames = d.getFrameRate() * 10;
+    KeyFinder::AudioData chunk;
+    unsigned int chunks = 0;
+    unsigned int totalFrames = 0;
+    while (d.decodeNextAudioChunk(chunk, chunkFrames)) {
+        ASSERT_EQ(d.getFrameRate(), chunk.getFrameRate());
+        ASSERT_EQ(d.getChannels(), chunk.getChannels());
+        ASSERT_LE(chunk.getFrameCount(), chunkFrames);
+        totalFrames += chunk.getFrameCount();
+        chunks++;
+    }
+    ASSERT_EQ((totalFrames + chunkFrames - 1) / chunkFrames, chunks);
+    ASSERT_NEAR(90.0, (double) totalFrames / d.getFrameRate(), 0.5);
+}
+
+// opens on many threads at once decode the same as one at a time
+TEST (AudioFileDecoderTest, ConcurrentOpensMatchSerialOpens) {
+    QStringList formats;
+    formats << "aac.m4a" << "aiff.aiff" << "alac.m4a" << "flac.flac" << "mp3 with id3 v2.4.mp3" << "wav.wav" << "wma.wma";
+    QStringList paths;
+    for (int i = 0; i < 64; i++)
+        paths << "../is_KeyFinder/test-resources/readTags/" + formats[i % formats.size()];
+    QThreadPool pool; // rather than resize the global one under later tests
+    pool.setMaxThreadCount(16);
+    QList<QFuture<int> > parallel;
+    for (int i = 0; i < paths.size(); i++)
+        parallel << QtConcurrent::run(&pool, openAndDecodeFirstChunk, paths[i]);
+    for (int i = 0; i < paths.size(); i++) {
+        ASSERT_LT(0, parallel[i].result());
+        ASSERT_EQ(openAndDecodeFirstChunk(paths[i]), parallel[i].result());
+    }
+}
+
+#ifdef Q_OS_UNIX
+// mono 16-bit PCM at 44.1 kHz, a quiet sine
+static QByteArray shortWav(unsigned int frames) {
+    QByteArray wav;
+    QDataStream out(&wav, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.writeRawData("RIFF", 4);
+    out << (quint32) (36 + frames * 2);
+    out.writeRawData("WAVEfmt ", 8);
+    out << (quint32) 16 << (quint16) 1 << (quint16) 1 << (quint32) 44100 << (quint32) 88200 << (quint16) 2 << (quint16) 16;
+    out.writeRawData("data", 4);
+    out << (quint32) (frames * 2);
+    for (unsigned int i = 0; i < frames; i++)
+        out << (qint16) (8000 * sin(2 * 3.14159265 * 440.0 * i / 44100.0));
+    return wav;
+}
+
+// an open stalled on slow storage doesn't hold up opens on other threads
+TEST (AudioFileDecoderTest, StalledOpenDoesNotBlockOtherOpens) {
+    QTemporaryDir dir;
+    QString fifo = dir.path() + "/stalled.wav";
+    ASSERT_EQ(0, mkfifo(QFile::encodeName(fifo).constData(), 0600));
+    QThreadPool pool;
+    // blocks opening the pipe until something writes to it
+    QFuture<int> stalled = QtConcurrent::run(&pool, openAndDecodeFirstChunk, fifo);
+    QThread::msleep(100);
+    QFuture<int> other = QtConcurrent::run(&pool, openAndDecodeFirstChunk, QString("../is_KeyFinder/test-resources/readTags/wav.wav"));
+    QElapsedTimer timer;
+    timer.start();
+    while (!other.isFinished() && timer.elapsed() < 10000)
+        QThread::msleep(10);
+    bool overlapped = other.isFinished() && !stalled.isFinished();
+    // release the stalled open whatever happened
+    QFile writer(fifo);
+    ASSERT_TRUE(writer.open(QIODevice::WriteOnly));
+    writer.write(shortWav(11025));
+    writer.close();
+    ASSERT_TRUE(overlapped);
+    ASSERT_LT(0, other.result());
+    ASSERT_EQ(11025, stalled.result());
+}
+#endif
+
+// a copy of a test resource under another name
+static QString copyAs(const QTemporaryDir& dir, const QString& resource, const QString& name) {
+    QString path = dir.path() + "/" + name;
+    QFile::copy("../is_KeyFinder/test-resources/readTags/" + resource, path);
+    return path;
+}
+
+TEST (AudioFileDecoderTest, OpensMisnamedFiles) {
+    QTemporaryDir dir;
+    int expected = openAndDecodeFirstChunk("../is_KeyFinder/test-resources/readTags/wav.wav");
+    ASSERT_LT(0, expected);
+    // the hinted demuxer can't open it at all, so it's opened again with a
+    // full probe
+    ASSERT_EQ(expected, openAndDecodeFirstChunk(copyAs(dir, "wav.wav", "wav.m4a")));
+    // the hinted demuxer opens it, but can't find the audio parameters in
+    // its small probe
+    ASSERT_EQ(expected, openAndDecodeFirstChunk(copyAs(dir, "wav.wav", "wav.aac")));
+}
+
+#ifdef Q_OS_LINUX
+static int openDescriptors() {
+    return QDir("/proc/self/fd").entryList(QDir::AllEntries | QDir::System | QDir::NoDotAndDotDot).size();
+}
+
+TEST (AudioFileDecoderTest, FailedHintedOpenReleasesItsFile) {
+    QTemporaryDir dir;
+    QString path = copyAs(dir, "wav.wav", "wav.m4a");
+    int before = openDescriptors();
+    for (int i = 0; i < 10; i++)
+        ASSERT_LT(0, openAndDecodeFirstChunk(path));
+    ASSERT_EQ(before, openDescriptors());
+}
+#endif
+
+TEST (AudioFileDecoderTest, SeekSkipsAudio) {
+    QString path("../is_KeyFinder/test-resources/90secondsine.mp3");
+    AudioFileDecoder d(path, 60);
+    ASSERT_NEAR(90.0, d.getDurationSeconds(), 1.0);
+    ASSERT_TRUE(d.seekToSeconds(80.0));
+    KeyFinder::AudioData chunk;
+    unsigned int totalFrames = 0;
+    while (d.decodeNextAudioChunk(chunk, d.getFrameRate()))
+        totalFrames += chunk.getFrameCount();
+    ASSERT_NEAR(10.0, (double) totalFrames / d.getFrameRate(), 1.0);
+}
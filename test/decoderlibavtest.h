@@ -22,6 +22,14 @@
 #ifndef DECODERLIBAVTEST_H
 #define DECODERLIBAVTEST_H
 
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QtConcurrent/QtConcurrent>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+
 #include "gtest/gtest.h"
 
 #include "../source/decoderlibav.h"
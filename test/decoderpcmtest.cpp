@@ -0,0 +1,111 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "decoderpcmtest.h"
+
+static std::vector<double> decodeAll(AudioDecoder& d) {
+    std::vector<double> samples;
+    KeyFinder::AudioData chunk;
+    while (d.decodeNextAudioChunk(chunk, d.getFrameRate() / 4)) {
+        for (unsigned int i = 0; i < chunk.getSampleCount(); i++)
+            samples.push_back(chunk.getSample(i));
+    }
+    return samples;
+}
+
+TEST (PcmFileDecoderTest, OpensWavAndAiff) {
+    PcmFileDecoder wav("../is_KeyFinder/test-resources/readTags/wav.wav", 60);
+    PcmFileDecoder aiff("../is_KeyFinder/test-resources/readTags/aiff.aiff", 60);
+    ASSERT_TRUE(wav.isOpen());
+    ASSERT_TRUE(aiff.isOpen());
+    ASSERT_EQ(44100u, wav.getFrameRate());
+    ASSERT_EQ(1u, wav.getChannels());
+    ASSERT_NEAR(1.0, wav.getDurationSeconds(), 0.01);
+    ASSERT_EQ(decodeAll(wav), decodeAll(aiff));
+}
+
+TEST (PcmFileDecoderTest, LeavesOtherFormatsClosed) {
+    PcmFileDecoder flac("../is_KeyFinder/test-resources/readTags/flac.flac", 60);
+    PcmFileDecoder pdf("../is_KeyFinder/test-resources/notAV.pdf", 60);
+    PcmFileDecoder missing("noFileHere", 60);
+    ASSERT_FALSE(flac.isOpen());
+    ASSERT_FALSE(pdf.isOpen());
+    ASSERT_FALSE(missing.isOpen());
+}
+
+TEST (PcmFileDecoderTest, MatchesLibav) {
+    QString path("../is_KeyFinder/test-resources/readTags/wav.wav");
+    for (int decimate = 0; decimate < 2; decimate++) {
+        PcmFileDecoder pcm(path, 60, decimate);
+        AudioFileDecoder libav(path, 60, decimate);
+        ASSERT_EQ(libav.getFrameRate(), pcm.getFrameRate());
+        ASSERT_EQ(libav.getChannels(), pcm.getChannels());
+        std::vector<double> expected = decodeAll(libav);
+        std::vector<double> actual = decodeAll(pcm);
+        ASSERT_EQ(expected.size(), actual.size());
+        for (unsigned int i = 0; i < expected.size(); i++)
+            ASSERT_NEAR(expected[i], actual[i], 0.001);
+    }
+}
+
+TEST (PcmFileDecoderTest, SeekSkipsAudio) {
+    PcmFileDecoder d("../is_KeyFinder/test-resources/readTags/aiff.aiff", 60);
+    ASSERT_TRUE(d.seekToSeconds(0.75));
+    ASSERT_EQ(11025u, decodeAll(d).size());
+}
+
+// an 18-byte fmt chunk (with a cbSize) puts the data at offset 46, which
+// isn't a multiple of a 32-bit float sample
+TEST (PcmFileDecoderTest, ReadsSamplesThatArentAligned) {
+    QTemporaryDir dir;
+    QString path = dir.path() + "/aligned.wav";
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    unsigned int frames = 1000;
+    out.writeRawData("RIFF", 4);
+    out << (quint32) (38 + frames * 4);
+    out.writeRawData("WAVEfmt ", 8);
+    out << (quint32) 18 << (quint16) 3 << (quint16) 1 << (quint32) 44100 << (quint32) 176400 << (quint16) 4 << (quint16) 32 << (quint16) 0;
+    out.writeRawData("data", 4);
+    out << (quint32) (frames * 4);
+    for (unsigned int i = 0; i < frames; i++)
+        out << (float) i / frames;
+    file.close();
+    PcmFileDecoder d(path, 60);
+    ASSERT_TRUE(d.isOpen());
+    std::vector<double> samples = decodeAll(d);
+    ASSERT_EQ(frames, samples.size());
+    for (unsigned int i = 0; i < frames; i++)
+        ASSERT_FLOAT_EQ((float) i / frames, samples[i]);
+}
+
+TEST (PcmFileDecoderTest, FactoryFallsBackToLibav) {
+    AudioDecoderFactory factory;
+    AudioDecoder* wav = factory.createAudioDecoder("../is_KeyFinder/test-resources/readTags/wav.wav", 60);
+    AudioDecoder* flac = factory.createAudioDecoder("../is_KeyFinder/test-resources/readTags/flac.flac", 60);
+    ASSERT_TRUE(dynamic_cast<PcmFileDecoder*>(wav) != NULL);
+    ASSERT_TRUE(dynamic_cast<AudioFileDecoder*>(flac) != NULL);
+    delete wav;
+    delete flac;
+}
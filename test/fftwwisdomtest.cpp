@@ -0,0 +1,54 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "fftwwisdomtest.h"
+
+TEST (FftwWisdomTest, CachePathIsInConfigDirectory) {
+    QString config = QStandardPaths::writableLocation(QStandardPaths::ConfigLocation);
+    ASSERT_TRUE(FftwWisdom::cachePath().startsWith(config));
+}
+
+TEST (FftwWisdomTest, MissingOrCorruptCacheIsIgnored) {
+    QTemporaryDir dir;
+    ASSERT_FALSE(FftwWisdom::load(dir.path() + "/missing.wisdom"));
+    QFile corrupt(dir.path() + "/corrupt.wisdom");
+    ASSERT_TRUE(corrupt.open(QIODevice::WriteOnly));
+    corrupt.write("not wisdom");
+    corrupt.close();
+    ASSERT_FALSE(FftwWisdom::load(corrupt.fileName()));
+}
+
+TEST (FftwWisdomTest, WarmUpSurvivesRoundTrip) {
+    QTemporaryDir dir;
+    QString path = dir.path() + "/nested/fftw.wisdom";
+    FftwWisdom::startWarmUp();
+    FftwWisdom::waitForWarmUp();
+    ASSERT_TRUE(FftwWisdom::save(path));
+    QFile saved(path);
+    ASSERT_TRUE(saved.open(QIODevice::ReadOnly));
+    QByteArray wisdom = saved.readAll();
+    ASSERT_TRUE(wisdom.contains("fftw_wisdom"));
+    fftw_forget_wisdom();
+    ASSERT_TRUE(FftwWisdom::load(path));
+    char* reloaded = fftw_export_wisdom_to_string();
+    ASSERT_EQ(wisdom, QByteArray(reloaded));
+    free(reloaded);
+}
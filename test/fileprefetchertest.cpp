@@ -0,0 +1,81 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "fileprefetchertest.h"
+
+static QStringList prefetchPaths() {
+    QStringList paths;
+    paths << "../is_KeyFinder/test-resources/readTags/wav.wav";
+    paths << "../is_KeyFinder/test-resources/readTags/aiff.aiff";
+    paths << "../is_KeyFinder/test-resources/readTags/flac.flac";
+    paths << "../is_KeyFinder/test-resources/90secondsine.mp3";
+    return paths;
+}
+
+static void waitForWarmed(const FilePrefetcher& p, int files) {
+    for (int i = 0; i < 500 && p.getFilesWarmed() < files; i++)
+        QThread::msleep(10);
+}
+
+TEST (FilePrefetcherTest, WarmsTheNextFiles) {
+    FilePrefetcher p(prefetchPaths(), 2);
+    p.beginFile(0);
+    waitForWarmed(p, 2);
+    ASSERT_EQ(2, p.getFilesWarmed());
+    qint64 expectedBytes = QFileInfo(prefetchPaths()[1]).size() + QFileInfo(prefetchPaths()[2]).size();
+    ASSERT_EQ(expectedBytes, p.getBytesWarmed());
+    p.beginFile(1);
+    waitForWarmed(p, 3);
+    ASSERT_EQ(3, p.getFilesWarmed());
+    ASSERT_EQ(1, p.getFilesWarmedInTime());
+    ASSERT_LE(0, p.getHiddenMilliseconds());
+}
+
+TEST (FilePrefetcherTest, SkipsFilesAlreadyStarted) {
+    FilePrefetcher p(prefetchPaths(), 4);
+    p.beginFile(3);
+    p.beginFile(2);
+    p.beginFile(1);
+    p.beginFile(0);
+    QThread::msleep(100);
+    ASSERT_EQ(0, p.getFilesWarmed());
+    ASSERT_EQ(0, p.getFilesWarmedInTime());
+}
+
+TEST (FilePrefetcherTest, WarmsFromTheNextUnclaimedFile) {
+    FilePrefetcher p(prefetchPaths(), 1);
+    // another worker started on file 2 first, so file 1 is already taken
+    p.beginFile(2);
+    p.beginFile(0);
+    waitForWarmed(p, 1);
+    QThread::msleep(100);
+    ASSERT_EQ(1, p.getFilesWarmed());
+    ASSERT_EQ(QFileInfo(prefetchPaths()[3]).size(), p.getBytesWarmed());
+}
+
+TEST (FilePrefetcherTest, IgnoresOutOfRange) {
+    FilePrefetcher p(prefetchPaths(), 2);
+    p.beginFile(-1);
+    p.beginFile(4);
+    p.recordOpen(5);
+    ASSERT_EQ(0, p.getFilesWarmed());
+    ASSERT_EQ(5, p.getExposedMilliseconds());
+}
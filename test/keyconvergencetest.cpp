@@ -0,0 +1,78 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "keyconvergencetest.h"
+
+// bands run up from A in semitones
+static KeyFinder::Chromagram* chord(unsigned int hops, const std::vector<unsigned int>& pitchClasses) {
+    KeyFinder::Chromagram* ch = new KeyFinder::Chromagram(hops);
+    for (unsigned int h = 0; h < hops; h++) {
+        for (unsigned int band = 0; band < ch->getBands(); band++) {
+            bool on = std::find(pitchClasses.begin(), pitchClasses.end(), band % 12) != pitchClasses.end();
+            ch->setMagnitude(h, band, on ? 1.0 : 0.05);
+        }
+    }
+    return ch;
+}
+
+static void feed(KeyConvergence& convergence, KeyFinder::Chromagram* ch, double secondsAnalysed) {
+    KeyFinder::Workspace w;
+    w.chromagram = ch;
+    convergence.addHops(w, 0, secondsAnalysed);
+}
+
+static std::vector<unsigned int> aMajorTriad() {
+    std::vector<unsigned int> pcs;
+    pcs.push_back(0);
+    pcs.push_back(4);
+    pcs.push_back(7);
+    return pcs;
+}
+
+TEST (KeyConvergenceTest, TriadsLeadFlatSpectraDont) {
+    std::vector<double> triad(72, 0.05);
+    for (unsigned int b = 0; b < triad.size(); b++) {
+        if (b % 12 == 0 || b % 12 == 4 || b % 12 == 7) triad[b] = 1.0;
+    }
+    ASSERT_GT(KeyConvergence::leadOfBestKey(triad), 0.05);
+    std::vector<double> flat(72, 1.0);
+    ASSERT_FLOAT_EQ(0.0, KeyConvergence::leadOfBestKey(flat));
+}
+
+TEST (KeyConvergenceTest, ConvergesAfterTheSpan) {
+    KeyFinder::KeyFinder kf;
+    KeyConvergence convergence(kf, 0.05, 30.0);
+    for (int chunk = 1; chunk <= 6; chunk++) {
+        feed(convergence, chord(5, aMajorTriad()), chunk * 5.0);
+        ASSERT_FALSE(convergence.hasConverged());
+    }
+    feed(convergence, chord(5, aMajorTriad()), 35.0);
+    ASSERT_TRUE(convergence.hasConverged());
+}
+
+TEST (KeyConvergenceTest, NeverConvergesWithoutALead) {
+    KeyFinder::KeyFinder kf;
+    KeyConvergence convergence(kf, 0.05, 10.0);
+    std::vector<unsigned int> everything;
+    for (unsigned int pc = 0; pc < 12; pc++) everything.push_back(pc);
+    for (int chunk = 1; chunk <= 20; chunk++) feed(convergence, chord(5, everything), chunk * 5.0);
+    ASSERT_FALSE(convergence.hasConverged());
+}
@@ -0,0 +1,91 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "keytimelinetest.h"
+
+// bands run up from A in semitones; a, b and c are pitch classes of a triad
+static KeyFinder::Chromagram* triad(unsigned int hops, unsigned int a, unsigned int b, unsigned int c) {
+    KeyFinder::Chromagram* ch = new KeyFinder::Chromagram(hops);
+    for (unsigned int h = 0; h < hops; h++) {
+        for (unsigned int band = 0; band < ch->getBands(); band++) {
+            unsigned int pc = band % 12;
+            ch->setMagnitude(h, band, (pc == a || pc == b || pc == c) ? 1.0 : 0.05);
+        }
+    }
+    return ch;
+}
+
+static KeyFinder::key_t keyOf(KeyFinder::KeyFinder& kf, KeyFinder::Chromagram* ch) {
+    KeyFinder::Workspace w;
+    w.chromagram = ch;
+    return kf.keyOfChromagram(w);
+}
+
+// feeds a fresh chromagram per chunk, as when streaming
+static void feed(KeyTimeline& timeline, KeyFinder::Chromagram* ch, double secondsAnalysed) {
+    KeyFinder::Workspace w;
+    w.chromagram = ch;
+    timeline.addHops(w, 0, secondsAnalysed);
+}
+
+TEST (KeyTimelineTest, SplitsWhereTheKeyChanges) {
+    KeyFinder::KeyFinder kf;
+    KeyTimeline timeline(kf, 10);
+    for (int chunk = 1; chunk <= 6; chunk++) feed(timeline, triad(5, 0, 4, 7), chunk * 5.0);   // A major
+    for (int chunk = 7; chunk <= 12; chunk++) feed(timeline, triad(5, 3, 7, 10), chunk * 5.0); // C major
+    timeline.finish(60.0);
+    std::vector<KeySegment> segments = timeline.getSegments();
+    ASSERT_EQ(2u, segments.size());
+    ASSERT_EQ(keyOf(kf, triad(1, 0, 4, 7)), segments[0].key);
+    ASSERT_EQ(keyOf(kf, triad(1, 3, 7, 10)), segments[1].key);
+    ASSERT_FLOAT_EQ(0.0, segments[0].startSeconds);
+    ASSERT_FLOAT_EQ(30.0, segments[0].endSeconds);
+    ASSERT_FLOAT_EQ(30.0, segments[1].startSeconds);
+    ASSERT_FLOAT_EQ(60.0, segments[1].endSeconds);
+}
+
+TEST (KeyTimelineTest, FollowsAGrowingChromagram) {
+    KeyFinder::KeyFinder kf;
+    KeyTimeline growing(kf, 10);
+    KeyFinder::Workspace w;
+    w.chromagram = triad(20, 0, 4, 7);
+    growing.addHops(w, 0, 10.0);
+    growing.addHops(w, 20, 12.0); // no new hops
+    growing.finish(12.0);
+    ASSERT_EQ(1u, growing.getSegments().size());
+    ASSERT_FLOAT_EQ(12.0, growing.getSegments()[0].endSeconds);
+}
+
+TEST (KeyTimelineTest, NothingFedMeansNoSegments) {
+    KeyFinder::KeyFinder kf;
+    KeyTimeline timeline(kf, 10);
+    timeline.finish(0.0);
+    ASSERT_TRUE(timeline.getSegments().empty());
+}
+
+TEST (KeyTimelineTest, DescribesSegmentStarts) {
+    Preferences prefs(new SettingsWrapperFake());
+    std::vector<KeySegment> segments;
+    segments.push_back(KeySegment(0.0, 65.0, KeyFinder::A_MAJOR));
+    segments.push_back(KeySegment(65.0, 190.0, KeyFinder::C_MAJOR));
+    QString expected = "0:00 " + prefs.getKeyCode(KeyFinder::A_MAJOR) + ", 1:05 " + prefs.getKeyCode(KeyFinder::C_MAJOR);
+    ASSERT_EQ(expected, KeyTimeline::describe(segments, prefs, ", "));
+}
@@ -0,0 +1,64 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#include "localfileiotest.h"
+
+TEST (LocalFileIOTest, MissingFile) {
+    LocalFileIO io("noFileHere");
+    ASSERT_FALSE(io.isOpen());
+    ASSERT_TRUE(io.getContext() == NULL);
+}
+
+TEST (LocalFileIOTest, ReadsAndSeeks) {
+    QString path("../is_KeyFinder/test-resources/notAV.pdf");
+    LocalFileIO io(path);
+    ASSERT_TRUE(io.isOpen());
+    AVIOContext* ctx = io.getContext();
+    ASSERT_EQ(QFile(path).size(), avio_size(ctx));
+    unsigned char header[4];
+    ASSERT_EQ(4, avio_read(ctx, header, 4));
+    ASSERT_EQ(0, memcmp(header, "%PDF", 4));
+    ASSERT_EQ(avio_size(ctx) - 1, avio_seek(ctx, -1, SEEK_END));
+    ASSERT_EQ(1, avio_read(ctx, header, 4));
+    ASSERT_TRUE(ctx->eof_reached);
+}
+
+TEST (LocalFileIOTest, MapsLocalFiles) {
+    QTemporaryFile local;
+    ASSERT_TRUE(local.open());
+    local.write(QByteArray(4096, 'x'));
+    local.flush();
+    LocalFileIO io(local.fileName());
+    ASSERT_TRUE(io.isOpen());
+    ASSERT_TRUE(io.isMapped());
+}
+
+#ifdef Q_OS_UNIX
+TEST (LocalFileIOTest, LeavesPipesToLibav) {
+    QTemporaryDir dir;
+    QString fifo = dir.path() + "/pipe";
+    ASSERT_EQ(0, mkfifo(QFile::encodeName(fifo).constData(), 0600));
+    // opening a pipe would block until there's a writer; it isn't opened
+    LocalFileIO io(fifo);
+    ASSERT_FALSE(io.isOpen());
+}
+#endif
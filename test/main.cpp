@@ -29,7 +29,7 @@ int main(int argc, char* argv[]) {
   // libav setup, as per main.cpp
   av_register_all();
   av_log_set_level(AV_LOG_ERROR);
-  av_lockmgr_register(NULL);
+  av_lockmgr_register(AudioFileDecoder::libavLockManager);
 
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
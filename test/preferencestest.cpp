@@ -101,6 +101,25 @@ TEST (PreferencesTest, ConstructorDefaultsGui) {
     ASSERT_EQ(METADATA_FORMAT_KEYS, p.getMetadataFormat());
     ASSERT_FALSE(p.getSkipFilesWithExistingTags());
     ASSERT_EQ(60, p.getMaxDuration());
+    ASSERT_EQ(5, p.getDecodeChunkSeconds());
+    ASSERT_FALSE(p.getDecimateInDecoder());
+    ASSERT_FALSE(p.getFastScan());
+    ASSERT_EQ(6, p.getFastScanWindows());
+    ASSERT_EQ(10, p.getFastScanWindowSeconds());
+    ASSERT_EQ(2, p.getPrefetchDepth());
+    ASSERT_FALSE(p.getPipelineDecode());
+    ASSERT_TRUE(p.getStreamLongFiles());
+    ASSERT_TRUE(p.getFftwWarmUp());
+    ASSERT_EQ(0, p.getKeyTimelineSeconds());
+    ASSERT_EQ(20, p.getParallelChunkMinutes());
+    ASSERT_FALSE(p.getEarlyStop());
+    ASSERT_EQ(5, p.getEarlyStopMargin());
+    ASSERT_EQ(60, p.getEarlyStopSeconds());
+    ASSERT_TRUE(p.getResultCache());
+    ASSERT_FALSE(p.getResultCacheHash());
+    ASSERT_FALSE(p.getStoreChromagrams());
+    ASSERT_FALSE(p.getSilenceGate());
+    ASSERT_EQ(-60, p.getSilenceThreshold());
 #ifdef Q_OS_WIN
     QString iTunesLibraryPathDefault = QDir::homePath() + "/My Music/iTunes/iTunes Music Library.xml";
     QString traktorLibraryPathDefault = QDir::homePath() + "/My Documents/Native Instruments/Traktor 2.1.2/collection.nml";
@@ -164,6 +183,19 @@ TEST (PreferencesTest, Equality) {
     ASSERT_FALSE(a.equivalentTo(b));
 }
 
+TEST (PreferencesTest, DecodeChunkIsAtLeastASecond) {
+    SettingsWrapper* fakeSettings = new SettingsWrapperFake();
+    fakeSettings->beginGroup("batch");
+    fakeSettings->setValue("decodeChunkSeconds", 0);
+    fakeSettings->endGroup();
+    Preferences p(fakeSettings);
+    ASSERT_EQ(1, p.getDecodeChunkSeconds());
+    p.setDecodeChunkSeconds(-3);
+    ASSERT_EQ(1, p.getDecodeChunkSeconds());
+    p.setDecodeChunkSeconds(8);
+    ASSERT_EQ(8, p.getDecodeChunkSeconds());
+}
+
 TEST (PreferencesTest, NewStringDeterminesNoWriteCorrectly) {
     Preferences prefs;
     QString currentData = "data";
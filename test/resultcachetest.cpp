@@ -0,0 +1,179 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "resultcachetest.h"
+
+static void writeFile(const QString& path, const QByteArray& contents) {
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(contents);
+}
+
+static QByteArray identityOf(const QString& path) {
+    return ResultCache::fileIdentity(path, false);
+}
+
+static KeyFinderResultWrapper analysedAs(KeyFinder::key_t key) {
+    KeyFinderResultWrapper result;
+    result.core = key;
+    result.secondsAnalysed = 60.0;
+    result.durationSeconds = 240.0;
+    result.samplesSkipped = 44100;
+    result.keyTimeline.push_back(KeySegment(0.0, 120.0, key));
+    result.keyTimeline.push_back(KeySegment(120.0, 240.0, KeyFinder::C_MAJOR));
+    return result;
+}
+
+TEST (ResultCacheTest, RemembersResultsAcrossRuns) {
+    QTemporaryDir dir;
+    QString audio = dir.path() + "/track.mp3";
+    writeFile(audio, "not really audio");
+    Preferences prefs(new SettingsWrapperFake());
+    {
+        ResultCache cache(dir.path() + "/results.cache");
+        cache.store(identityOf(audio), prefs, analysedAs(KeyFinder::A_MINOR));
+    }
+    ResultCache cache(dir.path() + "/results.cache");
+    KeyFinderResultWrapper result;
+    result.batchRow = 7;
+    ASSERT_TRUE(cache.lookup(identityOf(audio), prefs, result));
+    ASSERT_EQ(KeyFinder::A_MINOR, result.core);
+    ASSERT_EQ(7, result.batchRow);
+    ASSERT_FLOAT_EQ(60.0, result.secondsAnalysed);
+    ASSERT_FLOAT_EQ(240.0, result.durationSeconds);
+    ASSERT_EQ(44100u, result.samplesSkipped);
+    ASSERT_EQ(2u, result.keyTimeline.size());
+    ASSERT_EQ(KeyFinder::C_MAJOR, result.keyTimeline[1].key);
+}
+
+TEST (ResultCacheTest, MissesWhenAnalysisSettingsChange) {
+    QTemporaryDir dir;
+    QString audio = dir.path() + "/track.mp3";
+    writeFile(audio, "not really audio");
+    Preferences prefs(new SettingsWrapperFake());
+    ResultCache cache(dir.path() + "/results.cache");
+    cache.store(identityOf(audio), prefs, analysedAs(KeyFinder::A_MINOR));
+    KeyFinderResultWrapper result;
+    prefs.setWriteToFilesAutomatically(!prefs.getWriteToFilesAutomatically()); // doesn't affect analysis
+    ASSERT_TRUE(cache.lookup(identityOf(audio), prefs, result));
+    prefs.setFastScan(!prefs.getFastScan());
+    ASSERT_FALSE(cache.lookup(identityOf(audio), prefs, result));
+    prefs.setFastScan(!prefs.getFastScan());
+    prefs.setSilenceThreshold(prefs.getSilenceThreshold() - 10);
+    ASSERT_FALSE(cache.lookup(identityOf(audio), prefs, result));
+    prefs.setSilenceThreshold(prefs.getSilenceThreshold() + 10);
+    ASSERT_TRUE(cache.lookup(identityOf(audio), prefs, result));
+    prefs.setDecodeChunkSeconds(prefs.getDecodeChunkSeconds() + 1);
+    ASSERT_FALSE(cache.lookup(identityOf(audio), prefs, result));
+}
+
+TEST (ResultCacheTest, MissesWhenTheFileChanges) {
+    QTemporaryDir dir;
+    QString audio = dir.path() + "/track.mp3";
+    writeFile(audio, "not really audio");
+    Preferences prefs(new SettingsWrapperFake());
+    ResultCache cache(dir.path() + "/results.cache");
+    cache.store(identityOf(audio), prefs, analysedAs(KeyFinder::A_MINOR));
+    writeFile(audio, "different length audio");
+    KeyFinderResultWrapper result;
+    ASSERT_FALSE(cache.lookup(identityOf(audio), prefs, result));
+    ASSERT_FALSE(cache.lookup(identityOf(dir.path() + "/missing.mp3"), prefs, result));
+}
+
+TEST (ResultCacheTest, OptionallyIdentifiesFilesByContent) {
+    QTemporaryDir dir;
+    QString audio = dir.path() + "/track.mp3";
+    writeFile(audio, "not really audio");
+    QByteArray sha1 = QCryptographicHash::hash("not really audio", QCryptographicHash::Sha1);
+    ASSERT_FALSE(ResultCache::fileIdentity(audio, false).endsWith(sha1));
+    ASSERT_TRUE(ResultCache::fileIdentity(audio, true).endsWith(sha1));
+}
+
+TEST (ResultCacheTest, DropsATruncatedRecord) {
+    QTemporaryDir dir;
+    QString audio = dir.path() + "/track.mp3";
+    QString other = dir.path() + "/other.mp3";
+    writeFile(audio, "not really audio");
+    writeFile(other, "not really audio either");
+    Preferences prefs(new SettingsWrapperFake());
+    QString path = dir.path() + "/results.cache";
+    {
+        ResultCache cache(path);
+        cache.store(identityOf(audio), prefs, analysedAs(KeyFinder::A_MINOR));
+        cache.store(identityOf(other), prefs, analysedAs(KeyFinder::B_MINOR));
+    }
+    QFile log(path);
+    ASSERT_TRUE(log.resize(log.size() - 5));
+    QString third = dir.path() + "/third.mp3";
+    writeFile(third, "still not audio");
+    {
+        ResultCache cache(path);
+        KeyFinderResultWrapper result;
+        ASSERT_TRUE(cache.lookup(identityOf(audio), prefs, result));
+        ASSERT_FALSE(cache.lookup(identityOf(other), prefs, result));
+        cache.store(identityOf(third), prefs, analysedAs(KeyFinder::C_MINOR));
+    }
+    // stored after the damage, and still there next time
+    ResultCache cache(path);
+    KeyFinderResultWrapper result;
+    ASSERT_TRUE(cache.lookup(identityOf(third), prefs, result));
+    ASSERT_EQ(KeyFinder::C_MINOR, result.core);
+    ASSERT_TRUE(cache.lookup(identityOf(audio), prefs, result));
+}
+
+TEST (ResultCacheTest, CompactingKeepsOtherProcessesRecords) {
+    QTemporaryDir dir;
+    QString audio = dir.path() + "/track.mp3";
+    QString other = dir.path() + "/other.mp3";
+    writeFile(audio, "not really audio");
+    writeFile(other, "not really audio either");
+    Preferences prefs(new SettingsWrapperFake());
+    QString path = dir.path() + "/results.cache";
+    // two caches on one log stand in for two processes
+    ResultCache ours(path);
+    ASSERT_EQ(0u, ours.size());
+    ResultCache theirs(path);
+    theirs.store(identityOf(other), prefs, analysedAs(KeyFinder::B_MINOR));
+    // enough replaced records that ours rewrites the log
+    for (int i = 0; i < 1100; i++) ours.store(identityOf(audio), prefs, analysedAs(KeyFinder::A_MINOR));
+    ASSERT_LT(QFileInfo(path).size(), 100 * 1024);
+    ResultCache next(path);
+    KeyFinderResultWrapper result;
+    ASSERT_TRUE(next.lookup(identityOf(other), prefs, result));
+    ASSERT_EQ(KeyFinder::B_MINOR, result.core);
+    ASSERT_TRUE(next.lookup(identityOf(audio), prefs, result));
+    ASSERT_EQ(KeyFinder::A_MINOR, result.core);
+    ASSERT_EQ(2u, next.size());
+}
+
+TEST (ResultCacheTest, HitsAreFast) {
+    QTemporaryDir dir;
+    QString audio = dir.path() + "/track.mp3";
+    writeFile(audio, "not really audio");
+    Preferences prefs(new SettingsWrapperFake());
+    ResultCache cache(dir.path() + "/results.cache");
+    cache.store(identityOf(audio), prefs, analysedAs(KeyFinder::A_MINOR));
+    KeyFinderResultWrapper result;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < 1000; i++) ASSERT_TRUE(cache.lookup(identityOf(audio), prefs, result));
+    ASSERT_LT(timer.nsecsElapsed() / 1000, 1000 * 1000); // well under a millisecond each
+}
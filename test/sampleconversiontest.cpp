@@ -0,0 +1,101 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+
+#include "sampleconversiontest.h"
+
+#include <vector>
+
+// odd lengths so the SIMD kernels' scalar tails get exercised
+static const int FRAMES = 37;
+static const int CHANNELS = 2;
+
+TEST (SampleConversionTest, PackedS16Interleaved) {
+    std::vector<int16_t> in(FRAMES * CHANNELS);
+    for (unsigned int i = 0; i < in.size(); i++)
+        in[i] = (int16_t)(i * 997 - 32000);
+    const uint8_t* planes[] = { reinterpret_cast<const uint8_t*>(&in[0]) };
+    std::vector<double> out(in.size());
+    SampleConversion::interleavedKernel(AV_SAMPLE_FMT_S16, CHANNELS)(planes, CHANNELS, FRAMES, &out[0]);
+    for (unsigned int i = 0; i < in.size(); i++)
+        ASSERT_DOUBLE_EQ((double) in[i], out[i]);
+}
+
+TEST (SampleConversionTest, PackedS32Interleaved) {
+    std::vector<int32_t> in(FRAMES * CHANNELS);
+    for (unsigned int i = 0; i < in.size(); i++)
+        in[i] = (int32_t)(i * 65536 * 13) - 2000000000;
+    const uint8_t* planes[] = { reinterpret_cast<const uint8_t*>(&in[0]) };
+    std::vector<double> out(in.size());
+    SampleConversion::interleavedKernel(AV_SAMPLE_FMT_S32, CHANNELS)(planes, CHANNELS, FRAMES, &out[0]);
+    for (unsigned int i = 0; i < in.size(); i++)
+        ASSERT_DOUBLE_EQ(in[i] / 65536.0, out[i]);
+}
+
+TEST (SampleConversionTest, PlanarFloatInterleaved) {
+    std::vector<float> left(FRAMES);
+    std::vector<float> right(FRAMES);
+    for (int i = 0; i < FRAMES; i++) {
+        left[i] = i / (float) FRAMES;
+        right[i] = -i / (float) FRAMES;
+    }
+    const uint8_t* planes[] = { reinterpret_cast<const uint8_t*>(&left[0]), reinterpret_cast<const uint8_t*>(&right[0]) };
+    std::vector<double> out(FRAMES * CHANNELS);
+    SampleConversion::interleavedKernel(AV_SAMPLE_FMT_FLTP, CHANNELS)(planes, CHANNELS, FRAMES, &out[0]);
+    for (int i = 0; i < FRAMES; i++) {
+        ASSERT_DOUBLE_EQ(left[i] * 32768.0, out[i * 2]);
+        ASSERT_DOUBLE_EQ(right[i] * 32768.0, out[i * 2 + 1]);
+    }
+}
+
+TEST (SampleConversionTest, PackedS16Downmix) {
+    std::vector<int16_t> in(FRAMES * CHANNELS);
+    for (unsigned int i = 0; i < in.size(); i++)
+        in[i] = (int16_t)(i % 2 == 0 ? 32767 - i : -32768 + 3 * i);
+    const uint8_t* planes[] = { reinterpret_cast<const uint8_t*>(&in[0]) };
+    std::vector<double> out(FRAMES);
+    SampleConversion::downmixKernel(AV_SAMPLE_FMT_S16, CHANNELS)(planes, CHANNELS, FRAMES, &out[0]);
+    for (int i = 0; i < FRAMES; i++)
+        ASSERT_DOUBLE_EQ((in[i * 2] + in[i * 2 + 1]) / 2.0, out[i]);
+}
+
+TEST (SampleConversionTest, PlanarFloatDownmix) {
+    std::vector<float> left(FRAMES);
+    std::vector<float> right(FRAMES);
+    for (int i = 0; i < FRAMES; i++) {
+        left[i] = 0.5f;
+        right[i] = i / (float) FRAMES;
+    }
+    const uint8_t* planes[] = { reinterpret_cast<const uint8_t*>(&left[0]), reinterpret_cast<const uint8_t*>(&right[0]) };
+    std::vector<double> out(FRAMES);
+    SampleConversion::downmixKernel(AV_SAMPLE_FMT_FLTP, CHANNELS)(planes, CHANNELS, FRAMES, &out[0]);
+    for (int i = 0; i < FRAMES; i++)
+        ASSERT_NEAR((left[i] + right[i]) * 16384.0, out[i], 0.01);
+}
+
+TEST (SampleConversionTest, UnsignedBytesAreCentred) {
+    std::vector<uint8_t> in(FRAMES, 128);
+    const uint8_t* planes[] = { &in[0] };
+    std::vector<double> out(FRAMES);
+    SampleConversion::interleavedKernel(AV_SAMPLE_FMT_U8, 1)(planes, 1, FRAMES, &out[0]);
+    for (int i = 0; i < FRAMES; i++)
+        ASSERT_DOUBLE_EQ(0.0, out[i]);
+}
@@ -0,0 +1,105 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "silencegatetest.h"
+
+// mono at 100 frames per second, so ten frames to a block; each block is
+// silent or a constant level
+static KeyFinder::AudioData blocks(const std::vector<double>& levels) {
+    KeyFinder::AudioData chunk;
+    chunk.setChannels(1);
+    chunk.setFrameRate(100);
+    chunk.addToSampleCount(levels.size() * 10);
+    for (unsigned int i = 0; i < levels.size() * 10; i++) {
+        chunk.setSample(i, levels[i / 10]);
+    }
+    return chunk;
+}
+
+TEST (SilenceGateTest, EnergyIsTheSumOfSquares) {
+    std::vector<double> samples;
+    double expected = 0.0;
+    for (int i = 0; i < 11; i++) {
+        samples.push_back(i - 5.5);
+        expected += (i - 5.5) * (i - 5.5);
+    }
+    ASSERT_DOUBLE_EQ(expected, SilenceGate::energy(&samples[0], samples.size()));
+    ASSERT_DOUBLE_EQ(0.0, SilenceGate::energy(&samples[0], 0));
+}
+
+TEST (SilenceGateTest, DropsSilentBlocksAndClosesUpTheRest) {
+    std::vector<double> levels;
+    levels.push_back(0.0);
+    levels.push_back(1000.0);
+    levels.push_back(1.0);
+    levels.push_back(0.5);
+    levels.push_back(2.0);
+    levels.push_back(-2000.0);
+    KeyFinder::AudioData chunk = blocks(levels);
+    SilenceGate gate(-60.0);
+    // the leading block, and the middle of the run; its ends stay either
+    // side of the join
+    ASSERT_EQ(20u, gate.apply(chunk));
+    ASSERT_EQ(40u, chunk.getFrameCount());
+    ASSERT_EQ(20u, gate.getSamplesSkipped());
+    const double expected[] = { 1000.0, 1.0, 2.0, -2000.0 };
+    for (unsigned int i = 0; i < 40; i++) {
+        ASSERT_EQ(expected[i / 10], chunk.getSample(i));
+    }
+}
+
+TEST (SilenceGateTest, JoinsOnlyBetweenSilentBlocksAcrossChunks) {
+    std::vector<double> first;
+    first.push_back(1000.0);
+    first.push_back(1.0);
+    first.push_back(1.0);
+    std::vector<double> second;
+    second.push_back(0.5);
+    second.push_back(2.0);
+    second.push_back(-2000.0);
+    SilenceGate gate(-60.0);
+    KeyFinder::AudioData chunk = blocks(first);
+    // what follows the last block isn't known yet
+    ASSERT_EQ(0u, gate.apply(chunk));
+    chunk = blocks(second);
+    ASSERT_EQ(10u, gate.apply(chunk));
+    ASSERT_EQ(20u, chunk.getFrameCount());
+    ASSERT_EQ(2.0, chunk.getSample(0));
+    ASSERT_EQ(-2000.0, chunk.getSample(10));
+}
+
+TEST (SilenceGateTest, LeavesLoudChunksAlone) {
+    std::vector<double> levels(5, 100.0); // about -50 dBFS
+    KeyFinder::AudioData chunk = blocks(levels);
+    SilenceGate gate(-60.0);
+    ASSERT_EQ(0u, gate.apply(chunk));
+    ASSERT_EQ(50u, chunk.getFrameCount());
+    ASSERT_EQ(0u, gate.getSamplesSkipped());
+}
+
+TEST (SilenceGateTest, CanEmptyAChunkBeforeAnythingIsKept) {
+    std::vector<double> levels(3, 10.0); // about -70 dBFS
+    KeyFinder::AudioData chunk = blocks(levels);
+    SilenceGate gate(-60.0);
+    ASSERT_EQ(30u, gate.apply(chunk));
+    ASSERT_EQ(0u, chunk.getFrameCount());
+    ASSERT_EQ(30u, gate.getSamplesSkipped());
+}
@@ -0,0 +1,89 @@
+/*************************************************************************
+
+  Copyright 2011-2015 Ibrahim Sha'ath
+
+  This file is part of KeyFinder.
+
+  KeyFinder is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  KeyFinder is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with KeyFinder.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+
+#include "spscringbuffertest.h"
+
+static void produceCounting(SpscRingBuffer<int>* ring, int count) {
+    for (int i = 0; i < count; i++) {
+        int* slot = ring->waitForWriteSlot();
+        if (slot == NULL) return;
+        *slot = i;
+        ring->publish();
+    }
+    ring->close();
+}
+
+TEST (SpscRingBufferTest, EmptyWhenClosed) {
+    SpscRingBuffer<int> ring(4);
+    ring.close();
+    ASSERT_TRUE(ring.waitForReadSlot() == NULL);
+}
+
+TEST (SpscRingBufferTest, HoldsCapacitySlots) {
+    SpscRingBuffer<int> ring(3);
+    for (int i = 0; i < 3; i++) {
+        int* slot = ring.waitForWriteSlot();
+        ASSERT_TRUE(slot != NULL);
+        *slot = i;
+        ring.publish();
+    }
+    ring.cancel(); // full, so this must return rather than wait
+    ASSERT_TRUE(ring.waitForWriteSlot() == NULL);
+    ring.close();
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(i, *ring.waitForReadSlot());
+        ring.release();
+    }
+    ASSERT_TRUE(ring.waitForReadSlot() == NULL);
+}
+
+TEST (SpscRingBufferTest, PassesEverythingInOrder) {
+    SpscRingBuffer<int> ring(4);
+    QFuture<void> producer = QtConcurrent::run(produceCounting, &ring, 100000);
+    int expected = 0;
+    int* slot;
+    while ((slot = ring.waitForReadSlot()) != NULL) {
+        ASSERT_EQ(expected, *slot);
+        ring.release();
+        expected++;
+    }
+    producer.waitForFinished();
+    ASSERT_EQ(100000, expected);
+}
+
+TEST (SpscRingBufferTest, CancelStopsProducer) {
+    SpscRingBuffer<int> ring(2);
+    QFuture<void> producer = QtConcurrent::run(produceCounting, &ring, 100000);
+    ring.waitForReadSlot();
+    ring.release();
+    ring.cancel();
+    producer.waitForFinished();
+    SUCCEED();
+}
+
+TEST (SpscRingBufferTest, NoWriteSlotOnceCancelled) {
+    SpscRingBuffer<int> ring(4);
+    ASSERT_TRUE(ring.waitForWriteSlot() != NULL);
+    ring.publish();
+    // free slots remain, but the consumer wants no more
+    ring.cancel();
+    ASSERT_TRUE(ring.waitForWriteSlot() == NULL);
+}
@@ -20,13 +20,47 @@
 #*************************************************************************
 
 HEADERS  += \
+  $$PWD/analysiscontexttest.h \
+  $$PWD/analysisresultqueuetest.h \
   $$PWD/asyncfileobjecttest.h \
+  $$PWD/asynckeyprocesstest.h \
   $$PWD/avfilemetadatatest.h \
+  $$PWD/chromagramaccumulatortest.h \
+  $$PWD/chromagramstoretest.h \
+  $$PWD/cuesheettest.h \
+  $$PWD/decimatortest.h \
   $$PWD/decoderlibavtest.h \
-  $$PWD/preferencestest.h
+  $$PWD/decoderpcmtest.h \
+  $$PWD/fftwwisdomtest.h \
+  $$PWD/fileprefetchertest.h \
+  $$PWD/keyconvergencetest.h \
+  $$PWD/keytimelinetest.h \
+  $$PWD/localfileiotest.h \
+  $$PWD/preferencestest.h \
+  $$PWD/resultcachetest.h \
+  $$PWD/sampleconversiontest.h \
+  $$PWD/silencegatetest.h \
+  $$PWD/spscringbuffertest.h
 
 SOURCES += \
+  $$PWD/analysiscontexttest.cpp \
+  $$PWD/analysisresultqueuetest.cpp \
   $$PWD/asyncfileobjecttest.cpp \
+  $$PWD/asynckeyprocesstest.cpp \
   $$PWD/avfilemetadatatest.cpp \
+  $$PWD/chromagramaccumulatortest.cpp \
+  $$PWD/chromagramstoretest.cpp \
+  $$PWD/cuesheettest.cpp \
+  $$PWD/decimatortest.cpp \
   $$PWD/decoderlibavtest.cpp \
-  $$PWD/preferencestest.cpp
+  $$PWD/decoderpcmtest.cpp \
+  $$PWD/fftwwisdomtest.cpp \
+  $$PWD/fileprefetchertest.cpp \
+  $$PWD/keyconvergencetest.cpp \
+  $$PWD/keytimelinetest.cpp \
+  $$PWD/localfileiotest.cpp \
+  $$PWD/preferencestest.cpp \
+  $$PWD/resultcachetest.cpp \
+  $$PWD/sampleconversiontest.cpp \
+  $$PWD/silencegatetest.cpp \
+  $$PWD/spscringbuffertest.cpp